@@ -11,11 +11,13 @@
 #endif
 #ifdef WIN32             // means WIN64, too, oddly
   #include <windows.h>
+  #include <sys/stat.h>  // stat for the detection cache key
 #else
   #include <sys/mman.h>  // mmap
   #include <sys/stat.h>  // fstat for filesize
   #include <fcntl.h>     // open
   #include <unistd.h>    // close
+  #include <sys/wait.h>  // WEXITSTATUS for the status of cmd
   #include <ctype.h>     // isspace
   #include <errno.h>     // errno
   #include <string.h>    // strerror
@@ -23,7 +25,16 @@
   #include <stdio.h>     // snprintf
   #include <math.h>      // ceil, sqrt, isfinite
 #endif
+#include <float.h>       // FLT_EVAL_METHOD
 #include <stdbool.h>
+#if defined(__AVX2__)
+  #include <immintrin.h> // _mm256_* used by seek_structural()
+#elif defined(__SSE2__)
+  #include <emmintrin.h> // _mm_* used by seek_structural()
+#endif
+#ifndef NOZLIB
+  #include <zlib.h>      // inflate() for gzip and BGZF input
+#endif
 #include "freadLookups.h"
 
 // Private globals to save passing all of them through to highly iterated field processors
@@ -57,16 +68,80 @@ static bool stripWhite=true;  // only applies to character columns; numeric fiel
 static bool skipEmptyLines=false;
 static int fill=0;
 static int *dropFill = NULL;
+static int *dropRun = NULL;  // dropRun[j]: number of consecutive CT_DROP columns from column j that skip_fields() may move over
+static size_t *colOff = NULL;  // colOff[j]: byte offset of column j within a row of the thread buffer of size[j]; see setColOffsets()
+
+// What the first pass over each jump found, so that a reread after out-of-sample type bumps can go straight to the lines of
+// the jumps it needs and move over the others
+typedef struct {
+  const char *start, *end;  // the jump's lines; end is NULL until the jump has been through the ordered section
+  int64_t nrow;             // rows pushed from the jump
+  int nbump;                // type bumps made by the time the jump was pushed; 0 means its rows were pushed as the types they were read as
+  bool reread;
+} jumpRecord;
+static jumpRecord *jumpRec = NULL;
+
+// What [6] and [7] detected for a file, its row count and the starts of its chunks, saved in args.cacheDir by a complete read
+// and used instead of detecting them again by a later read of the same file; see loadCache(). The file is recognised by its
+// path, size, modification time and a hash of its start; the arguments which affect detection by a hash of them.
+typedef struct {
+  char magic[8];
+  uint64_t fileSize, headHash, argsHash, sum;  // sum: hash of the rest of the cache file, to reject a partly written one
+  int64_t mtime, mtimeNsec;                    // mtimeNsec: the nanoseconds where the file system records them, else 0
+  int64_t pos;                                 // offset from sof of the column names (or first data row)
+  int64_t bytesRead, nrow, maxJumpRows;
+  int32_t ncol, nJumps, row1line, quoteRule, fill;
+  char sep, dec;
+  int8_t header;
+  bool autoFirstColName;
+} cacheHeader;
+static cacheHeader cacheHd;
+static int8_t *cacheType = NULL;   // the detected types, raised by any out-of-sample bumps when saving
+static int64_t *cacheJump = NULL;  // the chunk starts as offsets from sof
+
+// A CT_TIME_FORMAT column's format, compiled by compileTimeFormat() after [9] into a run of fixed steps ended by TF_END which
+// parse_time_format() follows for each field; e.g. "%d/%m/%Y" is TF_DAY, TF_LIT '/', TF_MONTH, TF_LIT '/', TF_YEAR
+typedef enum {
+  TF_END = 0, TF_LIT, TF_YEAR, TF_YEAR2, TF_MONTH, TF_MONTHNAME, TF_DAY, TF_HOUR, TF_HOUR12, TF_AMPM,
+  TF_MINUTE, TF_SECOND, TF_FSECOND, TF_TZ, TF_EPOCH, TF_EPOCHMS
+} timeFormatStep;
+typedef struct {
+  int8_t step;   // timeFormatStep
+  int8_t width;  // most digits a number may have; e.g. 2 for %m so that "%Y%m%d" reads 20240131
+  char lit;      // TF_LIT: the character; a number: ' ' when it may be padded with one space, as %e's day is
+} timeFormatOp;
+#define TF_MAXOP 64
+static timeFormatOp (*timeFormat)[TF_MAXOP] = NULL;  // timeFormat[j]: column j's steps when it is CT_TIME_FORMAT
+
+// jsonl: each line is a JSON object whose keys are the columns. The keys found while sampling are copied to jsonKeys, where
+// colNames[j] points to column j's, and are looked up through jsonSlot; see jsonColumn()
+static bool jsonl = false;
+static char *jsonKeys = NULL;
+static size_t jsonKeysSize = 0, jsonKeysAlloc = 0;
+static int *jsonSlot = NULL;  // open addressing hash table of 1-based column numbers, 0 for empty
+static int jsonSlots = 0;     // a power of 2 at least twice the number of keys
+static int jsonUnknown = 0;   // keys met by the read that sampling did not find; see [11]
+static char jsonUnknownKey[128];
+
+// widths=: each line is fixed width fields; column j is the fwfWidth[j] bytes from fwfStart[j] of its line
+static bool fwf = false;
+static int *fwfStart = NULL, *fwfWidth = NULL;
+#define FWF_BUFF 128  // a field is copied here (NUL terminated) for the parsers, which would run on into the next field
 
 static double NA_FLOAT64;  // takes fread.h:NA_FLOAT64_VALUE
 
 // Private globals so they can be cleaned up both on error and on successful return
 static void *mmp = NULL;
 static void *mmp_copy = NULL;
+static void *mmp_pipe = NULL;  // the output of `cmd` while it is inflated to mmp_copy when gzip compressed
+static int64_t *fileOff = NULL;  // multiple files: where each one's bytes start in mmp_copy; see readFiles()
+static char *fileHdr = NULL;     // multiple files: the first file's first line, which readFiles() skipped when repeated
 static size_t fileSize;
 static int8_t *type = NULL, *tmpType = NULL, *size = NULL;
 static lenOff *colNames = NULL;
 static freadMainArgs args = {0};  // global for use by DTPRINT; static implies ={0} but include the ={0} anyway just in case for valgrind #4639
+static size_t pageSize = 4096;
+static bool readAhead = false;  // INPUT_SEQUENTIAL or INPUT_HUGEPAGE: advise the pages of each thread's next chunk; see willNeed()
 #ifdef __EMSCRIPTEN__
   // Under Wasm we must keep the fd open until we're done with the mmap, due to an Emscripten bug (#5969).
   // TODO(emscripten-core/emscripten#20459): revert this
@@ -74,8 +149,8 @@ static freadMainArgs args = {0};  // global for use by DTPRINT; static implies =
 #endif
 
 // See header for more explanation.
-const char typeName[NUMTYPE][10] = {"drop", "bool8", "bool8", "bool8", "bool8", "bool8", "bool8", "int32", "int64", "float64", "float64", "float64", "int32", "float64", "string"};
-int8_t     typeSize[NUMTYPE]     = { 0,      1,       1,       1,       1,       1,      1,       4,       8,       8,         8,         8,         4,       8       ,  8      };
+const char typeName[NUMTYPE][10] = {"drop", "bool8", "bool8", "bool8", "bool8", "bool8", "bool8", "int32", "int64", "float64", "float64", "float64", "int32", "float64", "float64", "string"};
+int8_t     typeSize[NUMTYPE]     = { 0,      1,       1,       1,       1,       1,      1,       4,       8,       8,         8,         8,         4,       8       ,  8       ,  8      };
 
 // In AIX, NAN and INFINITY don't qualify as constant literals. Refer: PR #3043
 // So we assign them through below init function.
@@ -99,6 +174,9 @@ typedef struct FieldParseContext {
   // String "anchor" for `Field()` parser -- the difference `ch - anchor` will
   // be written out as the string offset.
   const char *anchor;
+  // Column of the field, for parsers whose layout is the column's; i.e.
+  // `parse_time_format()`
+  int col;
 } FieldParseContext;
 
 // Forward declarations
@@ -135,20 +213,10 @@ static char* const_cast(const char *ptr) {
 }
 
 /**
- * Free any resources / memory buffers allocated by the fread() function, and
- * bring all global variables to a "clean slate". This function should always be
- * executed when fread() exits, either successfully or not. But if it doesn't
- * for some reason (e.g. unexpected error/bug) then it is called again on starting
- * with verbose message if it needed to clean anything up.
+ * Unmap the input file, if mapped. `fileSize` must still be the size that was mapped.
  */
-bool freadCleanup(void)
+static void unmapFile(void)
 {
-  bool neededCleanup = (type || tmpType || size || colNames || mmp || mmp_copy);
-  free(type); type = NULL;
-  free(tmpType); tmpType = NULL;
-  free(size); size = NULL;
-  free(colNames); colNames = NULL;
-  free(dropFill); dropFill = NULL;
   if (mmp != NULL) {
     // Important to unmap as OS keeps internal reference open on file. Process is not exiting as
     // we're a .so/.dll here. If this was a process exiting we wouldn't need to unmap.
@@ -170,7 +238,44 @@ bool freadCleanup(void)
     #endif
     mmp = NULL;
   }
+}
+
+/**
+ * Free any resources / memory buffers allocated by the fread() function, and
+ * bring all global variables to a "clean slate". This function should always be
+ * executed when fread() exits, either successfully or not. But if it doesn't
+ * for some reason (e.g. unexpected error/bug) then it is called again on starting
+ * with verbose message if it needed to clean anything up.
+ */
+bool freadCleanup(void)
+{
+  bool neededCleanup = (type || tmpType || size || colNames || mmp || mmp_copy);
+  free(type); type = NULL;
+  free(tmpType); tmpType = NULL;
+  free(size); size = NULL;
+  free(colNames); colNames = NULL;
+  free(dropFill); dropFill = NULL;
+  free(dropRun); dropRun = NULL;
+  free(colOff); colOff = NULL;
+  free(jumpRec); jumpRec = NULL;
+  free(cacheType); cacheType = NULL;
+  free(cacheJump); cacheJump = NULL;
+  free(timeFormat); timeFormat = NULL;
+  free(jsonKeys); jsonKeys = NULL;
+  jsonKeysSize = jsonKeysAlloc = 0;
+  free(jsonSlot); jsonSlot = NULL;
+  jsonSlots = 0;
+  jsonUnknown = 0;
+  jsonl = false;
+  free(fwfStart); fwfStart = NULL;
+  free(fwfWidth); fwfWidth = NULL;
+  fwf = false;
+  unmapFile();
   free(mmp_copy); mmp_copy = NULL;
+  free(mmp_pipe); mmp_pipe = NULL;
+  readAhead = false;
+  free(fileOff); fileOff = NULL;
+  free(fileHdr); fileHdr = NULL;
   fileSize = 0;
   sep = whiteChar = quote = dec = '\0';
   quoteRule = -1;
@@ -190,6 +295,7 @@ bool freadCleanup(void)
 static inline uint64_t umax(uint64_t a, uint64_t b) { return a > b ? a : b; }
 static inline uint64_t umin(uint64_t a, uint64_t b) { return a < b ? a : b; }
 static inline  int64_t imin( int64_t a,  int64_t b) { return a < b ? a : b; }
+static inline  int64_t imax( int64_t a,  int64_t b) { return a > b ? a : b; }
 
 /** Return value of `x` clamped to the range [upper, lower] */
 static inline int64_t clamp_i64t(int64_t x, int64_t lower, int64_t upper) {
@@ -295,6 +401,119 @@ static inline bool end_of_field(const char *ch) {
 }
 
 
+/**
+ * Return the first position at or after `ch` holding either `c` or a byte <= 13 (which covers
+ * \0, \r and \n), or eof if there is none. This is the structural scan underneath Field() and
+ * nextGoodLine(): the candidate still has to be confirmed by the caller since \0 before eof and a
+ * lone \r (unless eol_one_r) do not end a field. Whole blocks are tested at once (32 bytes with
+ * AVX2, 16 with SSE2, otherwise 8 using SWAR) and only blocks lying entirely before eof are loaded,
+ * so we never read beyond the input even when eof has been moved back from the end of the mmap.
+ */
+static inline const char *seek_structural(const char *ch, const char c)
+{
+#if defined(__AVX2__) || defined(__SSE2__)
+  #if defined(__AVX2__)
+  const __m256i c32 = _mm256_set1_epi8(c), cr32 = _mm256_set1_epi8(13);
+  while (ch+32 <= eof) {
+    const __m256i v = _mm256_loadu_si256((const __m256i *)ch);
+    const __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, c32), _mm256_cmpeq_epi8(_mm256_min_epu8(v, cr32), v));  // ==c | <=13
+    const uint32_t mask = (uint32_t)_mm256_movemask_epi8(hit);
+    if (mask) return ch + __builtin_ctz(mask);
+    ch += 32;
+  }
+  #endif
+  const __m128i c16 = _mm_set1_epi8(c), cr16 = _mm_set1_epi8(13);
+  while (ch+16 <= eof) {
+    const __m128i v = _mm_loadu_si128((const __m128i *)ch);
+    const __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, c16), _mm_cmpeq_epi8(_mm_min_epu8(v, cr16), v));
+    const uint32_t mask = (uint32_t)_mm_movemask_epi8(hit);
+    if (mask) return ch + __builtin_ctz(mask);
+    ch += 16;
+  }
+#else
+  // SWAR: skip whole 8-byte words that contain neither c nor any byte <14, then finish bytewise below.
+  // Only 'is there a hit in this word' is asked of the bit tricks so byte order does not matter.
+  const uint64_t ones = 0x0101010101010101ULL, highs = 0x8080808080808080ULL, cs = ones * (uint8_t)c;
+  while (ch+8 <= eof) {
+    uint64_t w;
+    memcpy(&w, ch, 8);
+    const uint64_t x = w ^ cs;
+    if (((x - ones) & ~x & highs) | ((w - 14*ones) & ~w & highs)) break;
+    ch += 8;
+  }
+#endif
+  while (ch<eof && *ch!=c && (uint8_t)*ch>13) ch++;
+  return ch;
+}
+
+/**
+ * Line endings `e` in one chunk [ch,end) for the exact row count. Whether an ending is inside a quoted field depends on
+ * whether the chunk itself starts inside one, which only the chunks before it can tell. Each quote toggles (a doubled
+ * quote toggles twice) so both cases are counted at once: nOut of the n endings are outside quotes when the chunk starts
+ * outside, the other n-nOut when it starts inside. first[0] and first[1] are the first ending in those two cases and odd
+ * is whether the chunk holds an odd number of quotes. q=='\0' when quotes are not special.
+ * 64 bytes at a time with SSE2/AVX2: whether each byte is inside quotes is the prefix xor of the quote mask.
+ */
+typedef struct {
+  int64_t n, nOut;
+  const char *first[2];
+  bool odd;
+} chunkLines;
+
+static void countChunkLines(const char *ch, const char *end, const char q, const char e, chunkLines *c)
+{
+  int64_t n=0, nOut=0;
+  const char *first[2] = {NULL, NULL};
+  bool in = false;
+#if defined(__AVX2__) || defined(__SSE2__)
+  uint64_t carry = 0;  // all ones when the block starts inside quotes
+  while (ch+64 <= end) {
+    uint64_t qm=0, em=0;
+  #if defined(__AVX2__)
+    const __m256i q32 = _mm256_set1_epi8(q), e32 = _mm256_set1_epi8(e);
+    for (int k=0; k<2; k++) {
+      const __m256i v = _mm256_loadu_si256((const __m256i *)(ch+32*k));
+      qm |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, q32)) << (32*k);
+      em |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, e32)) << (32*k);
+    }
+  #else
+    const __m128i q16 = _mm_set1_epi8(q), e16 = _mm_set1_epi8(e);
+    for (int k=0; k<4; k++) {
+      const __m128i v = _mm_loadu_si128((const __m128i *)(ch+16*k));
+      qm |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, q16)) << (16*k);
+      em |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, e16)) << (16*k);
+    }
+  #endif
+    if (!q) qm = 0;
+    uint64_t inq = qm;
+    inq ^= inq<<1; inq ^= inq<<2; inq ^= inq<<4; inq ^= inq<<8; inq ^= inq<<16; inq ^= inq<<32;
+    inq ^= carry;
+    carry = 0 - (inq>>63);
+    const uint64_t out = em & ~inq, inside = em & inq;
+    n += __builtin_popcountll(em);
+    nOut += __builtin_popcountll(out);
+    if (!first[0] && out) first[0] = ch + __builtin_ctzll(out);
+    if (!first[1] && inside) first[1] = ch + __builtin_ctzll(inside);
+    ch += 64;
+  }
+  in = carry;
+#endif
+  for (; ch<end; ch++) {
+    if (*ch==q && q) in = !in;
+    else if (*ch==e) {
+      n++;
+      if (!in) { nOut++; if (!first[0]) first[0] = ch; }
+      else if (!first[1]) first[1] = ch;
+    }
+  }
+  c->n = n;
+  c->nOut = nOut;
+  c->first[0] = first[0];
+  c->first[1] = first[1];
+  c->odd = in;
+}
+
+
 static inline const char *end_NA_string(const char *start) {
   // start should be at the beginning of any potential NA string, after leading whitespace skipped by caller
   const char* const* nastr = NAstrings;
@@ -367,18 +586,19 @@ static inline const char *nextGoodLine(const char *ch, int ncol)
   // If this doesn't return the true line start, no matter. The previous thread will run-on and
   // resolve it. A good guess is all we need here. Being wrong will just be a bit slower.
   // If there are no embedded newlines, all newlines are true, and this guess will never be wrong.
-  while (*ch!='\n' && *ch!='\r' && (*ch!='\0' || ch<eof)) ch++;
+  while ((ch=seek_structural(ch, '\n'))<eof && *ch!='\n' && *ch!='\r') ch++;  // step over \0 before eof
   if (ch==eof) return eof;
   if (eol(&ch)) // move to last byte of the line ending sequence (e.g. \r\r\n would be +2).
     ch++;       // and then move to first byte of next line
   const char *simpleNext = ch;  // simply the first newline after the jump
+  if (jsonl || fwf) return simpleNext;  // a JSON string cannot contain a raw newline and widths= has no quoting: every line ending ends a row
   // if a better one can't be found, return this one (simpleNext). This will be the case when
   // fill=TRUE and the jump lands before 5 too-short lines, for example.
   int attempts=0;
   while (attempts++<5 && ch<eof) {
     const char *ch2 = ch;
     if (countfields(&ch2)==ncol) return ch;  // returns simpleNext here on first attempt, almost all the time
-    while (*ch!='\n' && *ch!='\r' && (*ch!='\0' || ch<eof)) ch++;
+    while ((ch=seek_structural(ch, '\n'))<eof && *ch!='\n' && *ch!='\r') ch++;
     if (eol(&ch)) ch++;
   }
   return simpleNext;
@@ -443,6 +663,61 @@ static const char* filesize_to_str(const uint64_t fsize)
   return output;
 }
 
+/**
+ * Advise that [from, from+n) of the mapped file will be read soon, so that its pages are read ahead while the thread
+ * is busy with the chunk before rather than faulted in one by one when it gets there.
+ */
+static void willNeed(const char *from, size_t n)
+{
+#if !defined(WIN32) && defined(MADV_WILLNEED)
+  if (!mmp || from<(const char *)mmp || from>=(const char *)mmp+fileSize) return;  // a copy or beyond the end
+  const size_t off = (size_t)(from - (const char *)mmp) & ~(pageSize-1);
+  madvise((char *)mmp + off, umin(n + pageSize, fileSize - off), MADV_WILLNEED);  // just advice; failure is of no consequence
+#endif
+}
+
+#ifndef WIN32
+/**
+ * Read the whole file into mmp_copy (with the extra byte for the final \0) using all threads, each reading large blocks
+ * with pread() so that a file system or device which does better with several requests in flight gets them.
+ */
+static void readFile(int fd, const char *fnam, int nth)
+{
+  mmp_copy = malloc(fileSize + 1);
+  if (!mmp_copy) { close(fd); STOP(_("Unable to allocate %s of contiguous virtual RAM to read the file: %s"), filesize_to_str(fileSize), fnam); } // # nocov
+  #ifdef MADV_HUGEPAGE
+    // large allocations are mmap()-ed anonymous memory, where transparent huge pages are most readily given
+    const uintptr_t huge = 2<<20, start = ((uintptr_t)mmp_copy + huge-1) & ~(huge-1), end = ((uintptr_t)mmp_copy + fileSize) & ~(huge-1);
+    if (end > start) madvise((void *)start, end-start, MADV_HUGEPAGE);
+  #endif
+  const size_t blockSize = 8<<20;
+  const int64_t nblock = (fileSize + blockSize - 1) / blockSize;
+  int err = 0;
+  #pragma omp parallel for num_threads(nth) schedule(dynamic)
+  for (int64_t b=0; b<nblock; b++) {
+    int thisErr;
+    #pragma omp atomic read
+    thisErr = err;
+    if (thisErr) continue;
+    char *dest = (char *)mmp_copy + b*blockSize;
+    const size_t n = umin(blockSize, fileSize - b*blockSize);
+    for (size_t got=0; got<n; ) {
+      const ssize_t r = pread(fd, dest+got, n-got, (off_t)(b*blockSize + got));
+      if (r<=0) {
+        if (r<0 && errno==EINTR) continue;  // # nocov
+        thisErr = r<0 ? errno : EIO;        // # nocov; a file that shrank since fstat() reads 0
+        #pragma omp atomic write
+        err = thisErr;                      // # nocov
+        break;                              // # nocov
+      }
+      got += r;
+    }
+  }
+  close(fd);
+  if (err) STOP(_("Error reading file %s: %s"), fnam, strerror(err)); // # nocov
+}
+#endif
+
 double copyFile(size_t fileSize)  // only called in very very rare cases
 {
   double tt = wallclock();
@@ -455,6 +730,440 @@ double copyFile(size_t fileSize)  // only called in very very rare cases
   return wallclock()-tt;
 }
 
+static inline uint32_t le32(const uint8_t *p) { return p[0] | (uint32_t)p[1]<<8 | (uint32_t)p[2]<<16 | (uint32_t)p[3]<<24; }
+
+/**
+ * Size of the BGZF block starting at `p`, or 0 if `p` is not the start of a complete BGZF block.
+ * A BGZF block (as written by bgzip) is a gzip member whose extra field contains the subfield
+ * 'BC' holding the block's compressed size minus 1; the member ends with the usual CRC32 and
+ * inflated size (ISIZE), so the blocks can be located and inflated independently of each other.
+ */
+static size_t bgzfBlockSize(const uint8_t *p, size_t avail)
+{
+  if (avail<18 || p[0]!=0x1F || p[1]!=0x8B || p[2]!=8 || !(p[3]&4)) return 0;  // gzip magic, deflate, FEXTRA
+  const size_t xlen = p[10] | (size_t)p[11]<<8;
+  const uint8_t *x = p+12, *xend = x+xlen;
+  if (12+xlen > avail) return 0;
+  while (x+4 <= xend) {
+    const size_t slen = x[2] | (size_t)x[3]<<8;
+    if (x[0]=='B' && x[1]=='C' && slen==2 && x+6<=xend) {
+      const size_t bsize = (x[4] | (size_t)x[5]<<8) + 1;
+      return (bsize >= 12+xlen+8 && bsize <= avail) ? bsize : 0;
+    }
+    x += 4+slen;
+  }
+  return 0;
+}
+
+/**
+ * The inflated size of a gzip member whose trailer holds `isize`, its size modulo 2^32. Deflate never makes its input
+ * more than a little larger (stored blocks add 5 bytes per 64KB), so an ISIZE well below the compressed size has
+ * wrapped around and the smallest size that hasn't is returned. A wrapped ISIZE above the compressed size can't be
+ * told apart, so this is a lower bound for files over 4GB.
+ */
+static uint64_t gzipSizeAtLeast(uint32_t isize, uint64_t compressed)
+{
+  uint64_t ans = isize;
+  while (ans + ans/1024 + 1024 < compressed) ans += (uint64_t)1<<32;
+  return ans;
+}
+
+#ifdef WIN32
+  #define FSEEK64 _fseeki64
+  #define FTELL64 _ftelli64
+#else
+  #define FSEEK64 fseeko
+  #define FTELL64 ftello
+#endif
+
+/**
+ * The size of gzip file `fnam` once inflated, without inflating it, so that fread() at R level can decompress a file
+ * which would not fit in memory to a temporary file instead. It is exact for a BGZF file (the sum of the ISIZE of its
+ * blocks, whose headers are read in turn); otherwise it is at least the size implied by the ISIZE of the last member,
+ * which is the whole file when there is only one. Returns -1 if the file can't be read.
+ */
+double gzipInflatedSize(const char *fnam)
+{
+  FILE *f = fopen(fnam, "rb");
+  if (!f) return -1.0;
+  static uint8_t hdr[12+65535];  // the fixed header and the extra field of a BGZF block
+  const int64_t size = FSEEK64(f, 0, SEEK_END) ? -1 : (int64_t)FTELL64(f);
+  if (size<0) { fclose(f); return -1.0; }
+  uint64_t ans = 0;
+  bool bgzf = true;
+  for (int64_t off=0; off<size; ) {
+    if (FSEEK64(f, off, SEEK_SET) || fread(hdr, 1, 12, f)!=12) { bgzf = false; break; }
+    const size_t xlen = hdr[10] | (size_t)hdr[11]<<8, bs = fread(hdr+12, 1, xlen, f)==xlen ? bgzfBlockSize(hdr, size-off) : 0;
+    if (!bs || FSEEK64(f, off+bs-4, SEEK_SET) || fread(hdr, 1, 4, f)!=4) { bgzf = false; break; }
+    ans += le32(hdr);
+    off += bs;
+  }
+  if (!bgzf) {
+    if (size<18 || FSEEK64(f, size-4, SEEK_SET) || fread(hdr, 1, 4, f)!=4) { fclose(f); return -1.0; }
+    ans = gzipSizeAtLeast(le32(hdr), size);
+  }
+  fclose(f);
+  return (double)ans;
+}
+
+/**
+ * The physical memory available without swapping, for the same decision: MemAvailable on Linux (which counts the page
+ * cache that can be reclaimed, unlike free memory), the available physical memory on Windows. -1 if not known.
+ */
+double availableRAM(void)
+{
+#ifdef WIN32
+  MEMORYSTATUSEX ms;
+  ms.dwLength = sizeof(ms);
+  return GlobalMemoryStatusEx(&ms) ? (double)ms.ullAvailPhys : -1.0;
+#else
+  FILE *f = fopen("/proc/meminfo", "r");
+  if (f) {
+    char line[256];
+    double kb = -1.0;
+    while (fgets(line, sizeof(line), f)) if (sscanf(line, "MemAvailable: %lf kB", &kb)==1) break;
+    fclose(f);
+    if (kb>=0) return kb*1024;
+  }
+  #ifdef _SC_AVPHYS_PAGES
+    const long pages = sysconf(_SC_AVPHYS_PAGES), pagesize = sysconf(_SC_PAGESIZE);
+    if (pages>0 && pagesize>0) return (double)pages * pagesize;
+  #endif
+  return -1.0;
+#endif
+}
+
+#ifndef NOZLIB
+/**
+ * Inflate the gzip input `in` of `fileSize` bytes, the file mapped at `mmp` or the output of `cmd`
+ * in `mmp_pipe`, into `mmp_copy` (with room for the final \0), which then replaces it. A BGZF file is inflated in parallel: its blocks are located
+ * from their headers and each thread inflates whole blocks directly to their final place. Any other
+ * gzip file, including concatenated members such as written by pigz or `cat a.gz b.gz`, is inflated
+ * by one thread since where its members start is not known until the previous one has been inflated.
+ * Returns the number of BGZF blocks, or 0 when inflated by one thread.
+ */
+static int64_t inflateFile(const uint8_t *in, const char *fnam, int nth)
+{
+  int64_t nblock = 0;
+  size_t outSize = 0;
+  for (size_t off=0, bs; off<fileSize; off+=bs, nblock++) {
+    if (!(bs = bgzfBlockSize(in+off, fileSize-off))) { nblock = 0; break; }
+    outSize += le32(in+off+bs-4);
+  }
+  if (nblock) {
+    size_t *inOff = malloc((nblock+1) * sizeof(*inOff)), *outOff = malloc((nblock+1) * sizeof(*outOff));
+    mmp_copy = malloc(outSize + 1 /* extra \0 */);
+    if (!inOff || !outOff || !mmp_copy) {
+      free(inOff); free(outOff); // # nocov
+      STOP(_("Unable to allocate %s of contiguous virtual RAM to inflate file: %s"), filesize_to_str(outSize), fnam); // # nocov
+    }
+    inOff[0] = outOff[0] = 0;
+    for (int64_t b=0; b<nblock; b++) {
+      inOff[b+1] = inOff[b] + bgzfBlockSize(in+inOff[b], fileSize-inOff[b]);
+      outOff[b+1] = outOff[b] + le32(in+inOff[b+1]-4);
+    }
+    bool failed = false;
+    #pragma omp parallel num_threads(nth)
+    {
+      z_stream zs = {0};
+      const bool ok = inflateInit2(&zs, 15+16) == Z_OK;  // 15+16: a gzip wrapper, whose CRC32 and ISIZE are checked by inflate()
+      if (!ok) failed = true;  // # nocov
+      #pragma omp for schedule(dynamic)
+      for (int64_t b=0; b<nblock; b++) {
+        if (failed) continue;
+        inflateReset(&zs);
+        zs.next_in = (Bytef *)(in + inOff[b]);
+        zs.avail_in = (uInt)(inOff[b+1] - inOff[b]);
+        zs.next_out = (Bytef *)mmp_copy + outOff[b];
+        zs.avail_out = (uInt)(outOff[b+1] - outOff[b]);
+        if (inflate(&zs, Z_FINISH) != Z_STREAM_END || zs.avail_in || zs.avail_out) failed = true;
+      }
+      if (ok) inflateEnd(&zs);
+    }
+    free(inOff); free(outOff);
+    if (failed) STOP(_("File is BGZF compressed but at least one of its blocks is corrupt: %s"), fnam);
+  } else {
+    // the buffer is sized from the final ISIZE, which is exact for a single member under 4GB. When that turns out to
+    // be too small (more members, or a wrapped ISIZE) it is grown to what the rest of the input inflates to at the
+    // ratio so far, plus an eighth, rather than doubled. Deflate can't compress by more than 1032:1, which bounds the
+    // first size when the ISIZE of a truncated file is garbage
+    size_t cap = (size_t)umin(gzipSizeAtLeast(le32(in+fileSize-4), fileSize), (uint64_t)fileSize*1032), outPos = 0, inPos = 0;
+    mmp_copy = malloc(cap + 1);
+    if (!mmp_copy) STOP(_("Unable to allocate %s of contiguous virtual RAM to inflate file: %s"), filesize_to_str(cap), fnam); // # nocov
+    z_stream zs = {0};
+    if (inflateInit2(&zs, 15+16) != Z_OK) STOP(_("zlib inflateInit2() failed: %s"), zs.msg ? zs.msg : ""); // # nocov
+    int ret = Z_OK;
+    while (true) {
+      if (outPos == cap) {
+        const double rest = (double)(fileSize-inPos) * (inPos ? (double)outPos/inPos : 1.0);
+        cap = outPos + (size_t)(rest * 1.125) + (1<<20);
+        void *tt = realloc(mmp_copy, cap + 1);
+        if (!tt) { inflateEnd(&zs); STOP(_("Unable to allocate %s of contiguous virtual RAM to inflate file: %s"), filesize_to_str(cap), fnam); } // # nocov
+        mmp_copy = tt;
+      }
+      // avail_in and avail_out are uInt so feed files over 4GB in pieces
+      const uInt availIn = (uInt)umin(fileSize-inPos, 1<<30), availOut = (uInt)umin(cap-outPos, 1<<30);
+      zs.next_in = (Bytef *)(in + inPos);
+      zs.avail_in = availIn;
+      zs.next_out = (Bytef *)mmp_copy + outPos;
+      zs.avail_out = availOut;
+      ret = inflate(&zs, Z_NO_FLUSH);
+      inPos += availIn - zs.avail_in;
+      outPos += availOut - zs.avail_out;
+      if (ret == Z_STREAM_END) {
+        // another member may follow; anything else after the end, such as padding zeros, is ignored as gzip itself does
+        if (fileSize-inPos < 18 || in[inPos]!=0x1F || in[inPos+1]!=0x8B) break;
+        inflateReset(&zs);
+      } else if ((ret != Z_OK && ret != Z_BUF_ERROR) || (inPos == fileSize && outPos < cap)) {
+        inflateEnd(&zs);
+        STOP(_("File is gzip compressed but could not be inflated (%s) after %s of input: %s"),
+             ret==Z_OK || ret==Z_BUF_ERROR ? _("it is truncated") : (zs.msg ? zs.msg : "zlib error"), filesize_to_str(inPos), fnam);
+      }
+    }
+    inflateEnd(&zs);
+    outSize = outPos;
+  }
+  unmapFile();
+  free(mmp_pipe); mmp_pipe = NULL;
+  fileSize = outSize;
+  return nblock;
+}
+#endif
+
+#ifdef WIN32
+  #define FSEEK64 _fseeki64
+  #define FTELL64 _ftelli64
+#else
+  #define FSEEK64 fseeko
+  #define FTELL64 ftello
+#endif
+
+/**
+ * Read `nfile` files whole into `mmp_copy` one after another, which is then the input as if it were one file. In the
+ * files after the first, a BOM and a first line identical to the first file's (the repeated column names, when
+ * `skipHeader`; provisionally with header="auto", see unskipFirstLines()) are not copied. Nor are the blank lines at
+ * the end of each file, so that none is left between one file's rows and the next's, and each file's rows end with a
+ * line ending (one is added when missing).
+ * The files are read in parallel, twice: first for each one's size, repeated header and blank tail, which tell where
+ * its bytes go, then to read those bytes directly into their place. Sets fileOff[k] to where file k starts in
+ * `mmp_copy` (fileOff[nfile]==fileSize), and fileOff[4*(nfile+1)+k] to the bytes to put back when the first line of
+ * file k was skipped (that line and its line ending, otherwise 0), and returns the number of repeated headers skipped.
+ */
+static int readFiles(const char * const *fnames, const int nfile, const bool skipHeader, const int nth)
+{
+  fileOff = malloc(sizeof(*fileOff) * 5 * (nfile+1));
+  if (!fileOff)
+    STOP(_("Failed to allocate %zu bytes for '%s'."), sizeof(*fileOff) * 5 * (nfile+1), "fileOff"); // # nocov
+  // len[k]<0 when file k could not be opened (-1, with its errno in pad[k]) or read (-2), or is compressed (-3)
+  int64_t *skip = fileOff + (nfile+1), *len = skip + (nfile+1), *pad = len + (nfile+1), *back = pad + (nfile+1);
+
+  // the first line of the first file, without its BOM or line ending
+  char *hdr = NULL;
+  int64_t hdrStart = 0, hdrLen = -1;  // -1: no header to skip
+  if (skipHeader) {
+    FILE *f = fopen(fnames[0], "rb");
+    if (!f) STOP(_("Couldn't open file %s: %s"), fnames[0], strerror(errno));
+    size_t cap = 4096, n = 0;
+    for (bool more=true; more; cap*=2) {
+      char *tt = realloc(hdr, cap);
+      if (!tt) { free(hdr); fclose(f); STOP(_("Failed to allocate %zu bytes for '%s'."), cap, "hdr"); } // # nocov
+      hdr = tt;
+      const size_t from = n;
+      n += fread(hdr+n, 1, cap-n, f);
+      if (from==0 && n>=3 && !memcmp(hdr, "\xEF\xBB\xBF", 3)) hdrStart = 3;
+      for (size_t i=imax(from, hdrStart); i<n && hdrLen<0; i++) if (hdr[i]=='\n' || hdr[i]=='\r') hdrLen = i-hdrStart;
+      if (hdrLen<0 && n<cap && n>(size_t)hdrStart) hdrLen = n-hdrStart;  // the whole file is one line
+      more = hdrLen<0 && n==cap;
+    }
+    fclose(f);
+  }
+  const size_t bufSize = imax(4096, hdrStart+hdrLen+2);  // room for the first line of each file to compare to the header
+
+  int nhdr = 0;
+  #pragma omp parallel num_threads(nth) reduction(+:nhdr)
+  {
+    char *buf = malloc(bufSize);
+    #pragma omp for schedule(dynamic)
+    for (int k=0; k<nfile; k++) {
+      len[k] = pad[k] = back[k] = 0;
+      if (!buf) { len[k] = -2; continue; } // # nocov
+      FILE *f = fopen(fnames[k], "rb");
+      if (!f) { len[k] = -1; pad[k] = errno; continue; }
+      const int64_t size = FSEEK64(f, 0, SEEK_END) ? -1 : FTELL64(f);
+      size_t n = 0;
+      if (size<0 || FSEEK64(f, 0, SEEK_SET) || (n=fread(buf, 1, bufSize, f))!=(size_t)imin(size, bufSize)) { fclose(f); len[k] = -2; continue; }
+      if (n>=3 && (uint8_t)buf[0]==0x1F && (uint8_t)buf[1]==0x8B && buf[2]==8) { fclose(f); len[k] = -3; continue; }
+      skip[k] = 0;
+      if (k>0) {
+        const int64_t h = n>=3 && !memcmp(buf, "\xEF\xBB\xBF", 3) ? 3 : 0, e = h+hdrLen;  // e: just after the repeated header
+        skip[k] = h;
+        if (hdrLen>=0 && e<=(int64_t)n && !memcmp(buf+h, hdr+hdrStart, hdrLen)) {
+          if (e==size) skip[k] = size;  // only the header, without a line ending
+          else if (e<(int64_t)n && (buf[e]=='\n' || buf[e]=='\r')) skip[k] = e + (buf[e]=='\r' && e+1<(int64_t)n && buf[e+1]=='\n' ? 2 : 1);
+          if (skip[k]>h) { back[k] = hdrLen+1; nhdr++; }
+        }
+      }
+      // back over the whitespace at the end to the first line ending in it, which then ends the file's rows
+      int64_t t = size, eolAt = -1;
+      while (t>skip[k]) {
+        const int64_t from = imax(skip[k], t-(int64_t)bufSize);
+        if (FSEEK64(f, from, SEEK_SET) || fread(buf, 1, t-from, f)!=(size_t)(t-from)) { len[k] = -2; break; }
+        int64_t i = t-from;
+        while (i>0 && isspace((uint8_t)buf[i-1])) { i--; if (buf[i]=='\n' || buf[i]=='\r') eolAt = from+i; }
+        t = from+i;
+        if (i>0) break;
+      }
+      if (len[k]!=-2 && t>skip[k]) {  // else no rows
+        if (eolAt<0) {
+          len[k] = size-skip[k];
+          pad[k] = 1;  // the last line's ending is missing, so one is added
+        } else {
+          char eol2[2] = {0, 0};
+          if (FSEEK64(f, eolAt, SEEK_SET) || !fread(eol2, 1, 2, f)) len[k] = -2;
+          else len[k] = eolAt - skip[k] + (eol2[0]=='\r' && eol2[1]=='\n' ? 2 : 1);
+        }
+      }
+      fclose(f);
+    }
+    free(buf);
+  }
+  if (nhdr) {
+    memmove(hdr, hdr+hdrStart, hdrLen);
+    hdr[hdrLen] = '\0';
+    fileHdr = hdr;
+  } else free(hdr);
+  fileOff[0] = 0;
+  for (int k=0; k<nfile; k++) {
+    if (len[k]==-1) STOP(_("Couldn't open file %s: %s"), fnames[k], strerror((int)pad[k]));
+    if (len[k]==-2) STOP(_("Couldn't read file %s"), fnames[k]);
+    if (len[k]==-3) STOP(_("File is compressed, which is not supported when reading several files at once: %s"), fnames[k]);
+    fileOff[k+1] = fileOff[k] + len[k] + pad[k];
+  }
+  fileSize = fileOff[nfile];
+  if (fileSize==0) STOP(_("All %d files are empty or only contain column names, the first is: %s"), nfile, fnames[0]);
+  mmp_copy = malloc(fileSize + 1 /* extra \0 */);
+  if (!mmp_copy) STOP(_("Unable to allocate %s of contiguous virtual RAM to read %d files"), filesize_to_str(fileSize), nfile); // # nocov
+  #pragma omp parallel for num_threads(nth) schedule(dynamic)
+  for (int k=0; k<nfile; k++) {
+    if (!len[k]) continue;
+    char *dest = (char *)mmp_copy + fileOff[k];
+    FILE *f = fopen(fnames[k], "rb");
+    if (!f || FSEEK64(f, skip[k], SEEK_SET) || fread(dest, 1, len[k], f)!=(size_t)len[k]) len[k] = -2;
+    else if (pad[k]) dest[len[k]] = '\n';
+    if (f) fclose(f);
+  }
+  for (int k=0; k<nfile; k++) if (len[k]==-2) STOP(_("Couldn't read file %s"), fnames[k]);
+  return nhdr;
+}
+
+/**
+ * With header="auto", readFiles() skipped the first line of the files that repeated the first file's before it was known
+ * to be column names. When it turns out to be data after all, this puts those lines back in `mmp_copy` in place, from the
+ * last file backwards, each ending with `eolc`. sof, eof, *pos and *at (a pointer after pos) are moved to where their
+ * bytes went. Returns the number of lines put back.
+ */
+static int unskipFirstLines(const int nfile, const char eolc, const char **pos, const char **at)
+{
+  const int64_t *back = fileOff + 4*(nfile+1);
+  int64_t add = 0;
+  int n = 0;
+  bool tail = false;  // are lines put back after eof; i.e. files after the last row with only the repeated line
+  for (int k=1; k<nfile; k++) if (back[k]) {
+    add += back[k];
+    n++;
+    tail |= fileOff[k] >= eof-(const char *)mmp_copy;
+  }
+  if (!n) return 0;
+  const char *old = (const char *)mmp_copy;
+  int64_t off[] = {sof-old, eof-old, *pos-old, *at-old};  // where they are before the lines are put back
+  const char eofc = eof+1<old+fileSize && (eof[1]=='\n' || eof[1]=='\r') ? '\r' : eolc;  // the line ending at eof that \0 replaced
+  char *buf = realloc(mmp_copy, fileSize + add + 1);
+  if (!buf) STOP(_("Unable to allocate %s of contiguous virtual RAM to read %d files"), filesize_to_str(fileSize+add), nfile); // # nocov
+  mmp_copy = buf;
+  for (int i=0; i<4; i++) {
+    int64_t shift = 0;
+    for (int k=1; k<nfile && fileOff[k]<off[i]; k++) shift += back[k];
+    off[i] += shift;
+  }
+  int64_t shift = add;
+  for (int k=nfile-1; k>0; k--) {
+    memmove(buf+fileOff[k]+shift, buf+fileOff[k], fileOff[k+1]-fileOff[k]);
+    if (!back[k]) continue;
+    shift -= back[k];
+    memcpy(buf+fileOff[k]+shift, fileHdr, back[k]-1);
+    buf[fileOff[k]+shift+back[k]-1] = eolc;
+  }
+  for (int k=1; k<=nfile; k++) fileOff[k] += (shift += back[k-1]);  // back[0]==0
+  fileSize += add;
+  if (tail) {
+    // the \0 at eof is now followed by the lines put back, so its line ending is restored and the last one's replaced
+    buf[off[1]] = eofc;
+    off[1] = fileSize-1;
+  }
+  buf[off[1]] = buf[fileSize] = '\0';
+  sof = buf+off[0];
+  eof = buf+off[1];
+  *pos = buf+off[2];
+  *at = buf+off[3];
+  return n;
+}
+
+/**
+ * Read the standard output of `cmd` through a pipe into `mmp_copy` (with room for the final \0) as it is written,
+ * growing the buffer geometrically, so that no temporary file is needed: neither the disk space for all the output
+ * nor writing it there and reading it back. Once the output passes `maxMem` bytes it would not fit comfortably in
+ * memory, so what has been read and the rest of it are written to the file `spill` instead (when given), using the
+ * buffer to copy through, and true is returned for the file to be mapped; with `maxMem` 0 any output is. The command's
+ * exit status is put in `status`.
+ */
+static bool readPipe(const char *cmd, const char *spill, size_t maxMem, int *status)
+{
+  #ifdef WIN32
+    FILE *f = _popen(cmd, "rb");
+  #else
+    FILE *f = popen(cmd, "r");
+  #endif
+  if (!f) STOP(_("Couldn't run command %s: %s"), cmd, strerror(errno));
+  if (!spill) maxMem = SIZE_MAX;
+  size_t cap = umax(umin(1<<24, maxMem), 1<<16), n = 0, got = 0;
+  FILE *out = NULL;
+  bool writeFailed = false;
+  mmp_copy = malloc(cap + 1 /* extra \0 */);
+  do {
+    if (n == cap && mmp_copy) {
+      if (cap >= maxMem) {
+        if ((!out && !(out = fopen(spill, "wb"))) || fwrite(mmp_copy, 1, n, out) != n) { writeFailed = true; break; }
+        n = 0;
+      } else {
+        cap = umin(2*cap, maxMem);
+        void *tt = realloc(mmp_copy, cap + 1);
+        if (!tt) break;  // # nocov
+        mmp_copy = tt;
+      }
+    }
+    if (!mmp_copy) break;  // # nocov
+    n += got = fread((char *)mmp_copy + n, 1, umin(cap-n, 1<<26), f);  // up to 64MB at a time
+  } while (got);
+  const bool failed = ferror(f);
+  #ifdef WIN32
+    *status = _pclose(f);
+  #else
+    *status = pclose(f);
+  #endif
+  if (!out && maxMem==0 && n && !writeFailed && !(out = fopen(spill, "wb"))) writeFailed = true;
+  if (out) {
+    if (!writeFailed && fwrite(mmp_copy, 1, n, out) != n) writeFailed = true;
+    if (fclose(out)) writeFailed = true;
+    free(mmp_copy); mmp_copy = NULL;
+  }
+  if (writeFailed) STOP(_("Unable to write the output of command to the temporary file %s (%s): %s"), spill, strerror(errno), cmd); // # nocov
+  if (failed) STOP(_("Error reading the output of command: %s"), cmd); // # nocov
+  if (out) return true;
+  if (!mmp_copy || n == cap) STOP(_("Unable to allocate %s of contiguous virtual RAM to read the output of command: %s"), filesize_to_str(cap), cmd); // # nocov
+  fileSize = n;
+  return false;
+}
+
 
 //==============================================================================
 // Field parsers
@@ -509,7 +1218,7 @@ static void Field(FieldParseContext *ctx)
   const char *fieldStart=ch;
   if (*ch!=quote || quoteRule==3 || quote=='\0') {
     // Most common case. Unambiguously not quoted. Simply search for sep|eol. If field contains sep|eol then it should have been quoted and we do not try to heal that.
-    while(!end_of_field(ch)) ch++;  // sep, \r, \n or eof will end
+    while(!end_of_field(ch=seek_structural(ch, sep))) ch++;  // sep, \r, \n or eof will end; step over \0 and lone \r
     *(ctx->ch) = ch;
     int fieldLen = (int)(ch-fieldStart);
     //if (stripWhite) {   // TODO:  do this if and the next one together once in bulk afterwards before push
@@ -528,7 +1237,7 @@ static void Field(FieldParseContext *ctx)
   fieldStart++;  // step over opening quote
   switch(quoteRule) {
   case 0:  // quoted with embedded quotes doubled; the final unescaped " must be followed by sep|eol
-    while (*++ch || ch<eof) {
+    while ((ch=seek_structural(ch+1, quote))<eof) {  // embedded \r, \n and \0 are candidates too; step over them
       if (*ch==quote) {
         if (ch[1]==quote) { ch++; continue; }
         break;  // found undoubled closing quote
@@ -585,6 +1294,273 @@ static void Field(FieldParseContext *ctx)
   }
 }
 
+/**
+ * Reader for CT_DROP columns. Moves to the end of the field exactly as Field() does, but without
+ * computing its length or NA status or writing anything. Quoted fields are rare enough to be left
+ * to Field() itself.
+ */
+static void skip_field(FieldParseContext *ctx)
+{
+  const char *ch = *(ctx->ch);
+  if ((*ch==' ' && stripWhite) || (*ch=='\0' && ch<eof))
+    while(*++ch==' ' || (*ch=='\0' && ch<eof));
+  if (*ch==quote && quoteRule!=3 && quote!='\0') {
+    Field(ctx);
+    return;
+  }
+  while(!end_of_field(ch=seek_structural(ch, sep))) ch++;
+  *(ctx->ch) = ch;
+}
+
+/**
+ * Move over up to n fields of dropped columns, each including the sep that ends it, and return how
+ * many were moved over; *pch is left at the start of the next field. Stops early, at the start of
+ * the field, on a field containing a quote, \0, \r or \n (including the end of the line) so that
+ * the caller deals with that field using skip_field() as usual. With SSE2 or AVX2 the separators are
+ * counted a whole block at a time, so many short fields cost the same as one long one.
+ */
+static inline int skip_fields(const char **pch, const int n)
+{
+  const char *ch = *pch, *fieldStart = ch;
+  const char q = (quoteRule==3 || quote=='\0') ? '\n' : quote;  // '\n' is a stop byte anyway
+  int k = 0;
+#if defined(__AVX2__) || defined(__SSE2__)
+  #if defined(__AVX2__)
+  const __m256i s32 = _mm256_set1_epi8(sep), q32 = _mm256_set1_epi8(q), lf32 = _mm256_set1_epi8('\n'), cr32 = _mm256_set1_epi8('\r'), nul32 = _mm256_setzero_si256();
+  while (ch+32 <= eof) {
+    const __m256i v = _mm256_loadu_si256((const __m256i *)ch);
+    uint32_t seps = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, s32));
+    const uint32_t stop = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, q32), _mm256_cmpeq_epi8(v, nul32)),
+                                                                        _mm256_or_si256(_mm256_cmpeq_epi8(v, lf32), _mm256_cmpeq_epi8(v, cr32))));
+  #else
+  const __m128i s16 = _mm_set1_epi8(sep), q16 = _mm_set1_epi8(q), lf16 = _mm_set1_epi8('\n'), cr16 = _mm_set1_epi8('\r'), nul16 = _mm_setzero_si128();
+  while (ch+16 <= eof) {
+    const __m128i v = _mm_loadu_si128((const __m128i *)ch);
+    uint32_t seps = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, s16));
+    const uint32_t stop = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, q16), _mm_cmpeq_epi8(v, nul16)),
+                                                                  _mm_or_si128(_mm_cmpeq_epi8(v, lf16), _mm_cmpeq_epi8(v, cr16))));
+  #endif
+    if (stop) seps &= (stop & -stop) - 1;  // only the seps before the first stop byte count
+    const int nsep = __builtin_popcount(seps);
+    if (nsep >= n-k) {
+      for (int i=n-k; i>1; i--) seps &= seps-1;  // clear all but the (n-k)th sep
+      *pch = ch + __builtin_ctz(seps) + 1;
+      return n;
+    }
+    if (nsep) {
+      k += nsep;
+      fieldStart = ch + (31 - __builtin_clz(seps)) + 1;
+    }
+    if (stop) {
+      *pch = fieldStart;
+      return k;
+    }
+    ch += sizeof(v);
+  }
+#endif
+  for (; ch<eof; ch++) {
+    if (*ch==q || *ch=='\n' || *ch=='\r' || *ch=='\0') break;
+    if (*ch==sep) {
+      fieldStart = ch+1;
+      if (++k==n) break;
+    }
+  }
+  *pch = fieldStart;
+  return k;
+}
+
+/**
+ * Check that each filter column is read in this pass as a type its constants can be compared with. Called by the master
+ * thread before each team starts.
+ */
+static void checkFilterTypes(const int ncol, const char *colNamesAnchor)
+{
+  for (int f=0; f<args.nfilter; f++) {
+    const freadFilter *flt = args.filters + f;
+    const int j = flt->col;
+    if (j<0 || j>=ncol) INTERNAL_STOP("filter %d refers to column %d but there are %d columns", f+1, j+1, ncol); // # nocov
+    const int8_t t = IGNORE_BUMP(type[j]);
+    if (t==CT_DROP)
+      STOP(_("filter= uses column %d <<%.*s>> which is not being read. Please include it in select= or remove it from drop=."), j+1, colNames?colNames[j].len:0, colNames?(colNamesAnchor+colNames[j].off):"");
+    if (t==CT_STRING ? !flt->str : (t!=CT_EMPTY && !flt->num))
+      STOP(_("filter= compares column %d <<%.*s>> which is read as type '%s' with %s. Please use colClasses= to read it as the type of the value compared with."),
+           j+1, colNames?colNames[j].len:0, colNames?(colNamesAnchor+colNames[j].off):"", typeName[t], flt->num ? _("a number using <, <=, > or >=") : _("a string"));
+  }
+}
+
+/**
+ * String equality of a field as read with a constant. pushBuffer() strips embedded \0 from strings, so do the same here.
+ */
+static inline bool filterStrEqual(const char *s, const int len, const char *v, const int vlen)
+{
+  if (len==vlen && memcmp(s, v, len)==0) return true;
+  if (len<=vlen || !memchr(s, '\0', len)) return false;
+  int i = 0;
+  for (int c=0; c<len; c++) if (s[c]) {
+    if (i==vlen || s[c]!=v[i]) return false;
+    i++;
+  }
+  return i==vlen;
+}
+
+static inline bool filterRow(const ThreadLocalFreadParsingContext *ctx, const int8_t *ftype, const int64_t i)
+{
+  for (int f=0; f<args.nfilter; f++) {
+    const freadFilter *flt = args.filters + f;
+    const int8_t t = ftype[f];
+    const size_t off = colOff[flt->col]*ctx->buffRows;
+    bool na = false, keep = false;
+    if (t==CT_STRING) {
+      const lenOff *lo = (const lenOff *)((const char *)ctx->buff8 + off) + i;
+      na = lo->len==NA_LENOFF;
+      if (!na) {
+        const char *str = ctx->anchor + lo->off;
+        for (int k=0; k<flt->n && !keep; k++) keep = flt->str[k] && filterStrEqual(str, lo->len, flt->str[k], flt->strLen[k]);
+        if (flt->op==FILTER_NE) keep = !keep;
+      }
+    } else if (t==CT_INT64 && flt->i64) {
+      // integer64 with integer64 exactly, beyond the 2^53 a double holds
+      const int64_t x = ((const int64_t *)((const char *)ctx->buff8 + off))[i];
+      na = x==NA_INT64;
+      if (!na) switch (flt->op) {
+      case FILTER_EQ: keep = x==flt->i64[0]; break;
+      case FILTER_NE: keep = x!=flt->i64[0]; break;
+      case FILTER_LT: keep = x<flt->i64[0];  break;
+      case FILTER_LE: keep = x<=flt->i64[0]; break;
+      case FILTER_GT: keep = x>flt->i64[0];  break;
+      case FILTER_GE: keep = x>=flt->i64[0]; break;
+      case FILTER_IN: for (int k=0; k<flt->n && !keep; k++) keep = x==flt->i64[k]; break;
+      }
+    } else {
+      double v;
+      switch (size[flt->col]) {
+      case 1: { const int8_t x = ((const int8_t *)ctx->buff1 + off)[i]; na = x==NA_BOOL8; v = x; } break;
+      case 4: { const int32_t x = ((const int32_t *)((const char *)ctx->buff4 + off))[i]; na = x==NA_INT32; v = x; } break;
+      default:
+        if (t==CT_INT64) { const int64_t x = ((const int64_t *)((const char *)ctx->buff8 + off))[i]; na = x==NA_INT64; v = (double)x; }
+        else { v = ((const double *)((const char *)ctx->buff8 + off))[i]; na = isnan(v); }
+      }
+      if (!na) switch (flt->op) {
+      case FILTER_EQ: keep = v==flt->num[0]; break;
+      case FILTER_NE: keep = v!=flt->num[0]; break;
+      case FILTER_LT: keep = v<flt->num[0];  break;
+      case FILTER_LE: keep = v<=flt->num[0]; break;
+      case FILTER_GT: keep = v>flt->num[0];  break;
+      case FILTER_GE: keep = v>=flt->num[0]; break;
+      case FILTER_IN: for (int k=0; k<flt->n && !keep; k++) keep = v==flt->num[k]; break;
+      }
+    }
+    if (na) keep = flt->op==FILTER_IN && flt->naIn;
+    else if (flt->naIn && flt->op!=FILTER_IN) keep = false;
+    if (!keep) return false;
+  }
+  return true;
+}
+
+/**
+ * Apply args.filters to the nrow rows in a thread's buffers: the rows kept are moved up within each column, in order, and
+ * their number returned.
+ * If a filter column has been bumped in this pass its values in the buffer may be of the old type, so no row is kept: the
+ * file is reread with the new type and the rows are selected then. The filter columns' types are read once into the
+ * thread's ftype, as another thread may bump one while this buffer is filtered.
+ */
+static int64_t filterBuffer(const ThreadLocalFreadParsingContext *ctx, const int64_t nrow, int8_t *ftype)
+{
+  for (int f=0; f<args.nfilter; f++) if ((ftype[f] = type[args.filters[f].col])<0) return 0;
+  const size_t rs8=ctx->rowSize8, rs4=ctx->rowSize4, rs1=ctx->rowSize1, nb=ctx->buffRows;
+  char *b8=ctx->buff8, *b4=ctx->buff4, *b1=ctx->buff1;
+  int64_t kept = 0;
+  for (int64_t i=0; i<nrow; i++) {
+    if (!filterRow(ctx, ftype, i)) continue;
+    if (kept<i) {
+      for (size_t off=0; off<rs8; off+=8) memcpy(b8 + off*nb + kept*8, b8 + off*nb + i*8, 8);
+      for (size_t off=0; off<rs4; off+=4) memcpy(b4 + off*nb + kept*4, b4 + off*nb + i*4, 4);
+      for (size_t off=0; off<rs1; off++) b1[off*nb + kept] = b1[off*nb + i];
+    }
+    kept++;
+  }
+  return kept;
+}
+
+/**
+ * Set colOff[] for the sizes of this pass. Column j's block in a thread's column-major buffer for size[j] starts at byte
+ * colOff[j]*buffRows. Columns of size 0 (dropped, or not reread) get 0 so that their targets stay at the scratch slot
+ * given by setTarget(). Called by the master thread before each team starts.
+ */
+static void setColOffsets(const int ncol)
+{
+  size_t off[9] = {0};
+  for (int j=0; j<ncol; j++) {
+    colOff[j] = off[size[j]];
+    off[size[j]] += size[j];
+  }
+}
+
+/**
+ * Point the parser for type t (bump ignored) at row `row` of column j in the column-major buffers `buffs`, indexed by
+ * size, whose blocks have room for buffRows rows. A parser whose size is not size[j] writes to buffs[0], a scratch slot
+ * of the thread: the column is not reread in this pass, or another thread bumped its type and the value will be reread.
+ */
+static inline void setTarget(void **targets, void *const *buffs, const int j, const int8_t t, const int64_t row, const int64_t buffRows)
+{
+  const int8_t sz = typeSize[t];
+  targets[sz] = sz==size[j] ? (char *)buffs[sz] + colOff[j]*buffRows + row*sz : buffs[0];
+}
+
+/**
+ * Grow a thread's column-major buffer of row size rowSize, whose blocks of sz bytes per row hold nrow rows each, from
+ * oldRows to newRows rows per block. The blocks are moved to their new starts from the last, so that each is moved before
+ * the one ahead of it grows over it. Returns NULL if realloc failed.
+ */
+static void *growColumnBuffer(void *buff, const size_t rowSize, const int sz, const int64_t nrow, const int64_t oldRows, const int64_t newRows)
+{
+  char *b = realloc(buff, rowSize * newRows + sz);
+  if (!b) return NULL;
+  for (size_t off=rowSize; off>=2*(size_t)sz; ) {
+    off -= sz;
+    memmove(b + off*newRows, b + off*oldRows, nrow*sz);
+  }
+  return b;
+}
+
+/**
+ * Whether every value read as type `from` reads as the same number as type `to`, so that a column bumped between them keeps
+ * the values already pushed (allocateDT() converts them) and only needs rereading where they were not pushed as `from`.
+ */
+static bool losslessBump(const int8_t from, const int8_t to)
+{
+  if (to!=CT_INT32 && to!=CT_INT64 && to!=CT_FLOAT64 && to!=CT_FLOAT64_EXT) return false;
+  return from==CT_EMPTY || from==CT_BOOL8_N || from==CT_INT32 || (from==CT_INT64 && to!=CT_INT32) || (from==CT_FLOAT64 && to==CT_FLOAT64_EXT);
+}
+
+/**
+ * SWAR helpers for parsing 8 decimal digits at once. The 8 bytes at ch are loaded as a little-endian
+ * word so that the first character is the least significant byte; callers check ch+8<=eof first.
+ */
+static inline uint64_t load8_le(const char *ch)
+{
+  uint64_t w;
+  memcpy(&w, ch, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__==__ORDER_BIG_ENDIAN__
+  w = __builtin_bswap64(w);
+#endif
+  return w;
+}
+
+static inline bool is_eight_digits(const uint64_t w)
+{
+  // every byte is 0x30-0x39: high nibble is 3 and adding 6 does not carry out of the low nibble
+  return ((w & 0xF0F0F0F0F0F0F0F0ULL) | (((w + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) == 0x3333333333333333ULL;
+}
+
+static inline uint32_t eight_digits(uint64_t w)
+{
+  // combine adjacent digits pairwise: 8 x 1 digit -> 4 x 2 digits -> 2 x 4 digits -> 1 x 8 digits
+  w = ((w & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;                // 10*d0 + d1 in each 16 bits
+  w = ((w & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;            // 100*dd0 + dd1 in each 32 bits
+  return (uint32_t)(((w & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32);  // 10000*dddd0 + dddd1
+}
+
 static void str_to_i32_core(const char **pch, int32_t *target, bool parse_date)
 {
   const char *ch = *pch;
@@ -604,6 +1580,11 @@ static void str_to_i32_core(const char **pch, int32_t *target, bool parse_date)
   // number significant figures = digits from the first non-zero onwards including trailing zeros
   while (*ch=='0') ch++;
   uint_fast32_t sf = 0;
+  uint64_t w;
+  while (ch+sf+8<=eof && is_eight_digits(w=load8_le(ch+sf))) {  // long ids; acc may wrap after 19 digits but sf rejects those
+    acc = 100000000*acc + eight_digits(w);
+    sf += 8;
+  }
   while ( (digit=AS_DIGIT(ch[sf]))<10 ) {
     acc = 10*acc + digit;
     sf++;
@@ -641,6 +1622,11 @@ static void StrtoI64(FieldParseContext *ctx)
   uint_fast64_t acc = 0;  // important unsigned not signed here; we now need the full unsigned range
   uint_fast8_t digit;
   uint_fast32_t sf = 0;
+  uint64_t w;
+  while (ch+sf+8<=eof && is_eight_digits(w=load8_le(ch+sf))) {
+    acc = 100000000*acc + eight_digits(w);
+    sf += 8;
+  }
   while ( (digit=AS_DIGIT(ch[sf]))<10 ) {
     acc = 10*acc + digit;
     sf++;
@@ -671,8 +1657,93 @@ cat("1.0E300L\n};\n", file=f, append=TRUE)
 */
 
 
-// TODO  Add faster StrtoD_quick for small precision positive numerics such as prices without a sign or
-//       an E (e.g. $.cents) which don't need I64, long double, or Inf/NAN. Could have more than two levels.
+/*
+# generate pow5_128 in freadLookups.h (uses the gmp package for the 128-bit arithmetic)
+library(gmp)
+f = 'src/freadLookups.h'
+cat('const uint64_t pow5_128[651][2] = {\n', file=f, append=TRUE)
+two64 = as.bigz(2)^64
+for (q in -342:308) {
+  if (q < 0) {
+    p5 = as.bigz(5)^(-q)
+    z = 0L; while (as.bigz(2)^z < p5) z = z + 1L
+    v = as.bigz(2)^(if (q >= -27) z + 127L else 2L*z + 128L) %/% p5 + 1L
+  } else {
+    v = as.bigz(5)^q
+    while (v < as.bigz(2)^127) v = v * 2L
+  }
+  while (v >= as.bigz(2)^128) v = v %/% 2L
+  hex = function(x) formatC(as.character(x, b=16), width=16, flag="0")
+  cat(sprintf('  {0x%sULL, 0x%sULL},  // 5^%d\n', hex(v %/% two64), hex(v %% two64), q), sep='', file=f, append=TRUE)
+}
+cat('};\n', file=f, append=TRUE)
+*/
+
+// 10^0 .. 10^22 are exactly representable as double
+static const double pow10exact[23] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// high 64 bits of the 128-bit product a*b; the low 64 bits are written to *lo
+static inline uint64_t mul_u64(uint64_t a, uint64_t b, uint64_t *lo)
+{
+#ifdef __SIZEOF_INT128__
+  const unsigned __int128 r = (unsigned __int128)a * b;
+  *lo = (uint64_t)r;
+  return (uint64_t)(r >> 64);
+#else
+  const uint64_t aL = (uint32_t)a, aH = a >> 32, bL = (uint32_t)b, bH = b >> 32;
+  const uint64_t ll = aL*bL, lh = aL*bH, hl = aH*bL;
+  const uint64_t mid = (ll >> 32) + (uint32_t)lh + (uint32_t)hl;
+  *lo = (mid << 32) | (uint32_t)ll;
+  return aH*bH + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+}
+
+/**
+ * Eisel-Lemire: the correctly rounded double nearest to w*10^q using only 64-bit integer
+ * multiplications against the 128-bit significands of 5^q in pow5_128. See Lemire (2021)
+ * "Number Parsing at a Gigabyte per Second", Software: Practice and Experience 51(8).
+ * Returns false without writing to target when it cannot decide: when the truncated product
+ * is too close to a rounding boundary, the value is exactly half-way between two doubles, or
+ * the result would be subnormal or overflow. The caller then falls back to the long double path.
+ */
+static bool eisel_lemire(uint64_t w, int_fast32_t q, bool neg, double *target)
+{
+  if (w==0) {
+    *target = neg ? -0.0 : 0.0;
+    return true;
+  }
+  if (q < -342 || q > 308) return false;
+  const int lz = __builtin_clzll(w);
+  w <<= lz;
+  // floor(log2(10^q)) via 217706/2^16 ~= log2(10), plus the double exponent bias
+  uint64_t exp2 = (uint64_t)((((int_fast64_t)217706*q) >> 16) + 64 + 1023) - lz;
+  uint64_t lo, hi = mul_u64(w, pow5_128[q+342][0], &lo);
+  if ((hi & 0x1FF)==0x1FF && lo+w < w) {
+    // the lower 9 bits that decide rounding are all ones; the second word of 5^q may carry into them
+    uint64_t lo2, hi2 = mul_u64(w, pow5_128[q+342][1], &lo2);
+    const uint64_t mergedLo = lo + hi2;
+    hi += (mergedLo < lo);
+    if ((hi & 0x1FF)==0x1FF && mergedLo+1==0 && lo2+w < w) return false;
+    lo = mergedLo;
+  }
+  const uint64_t msb = hi >> 63;
+  uint64_t mant = hi >> (msb + 9);  // 54 bits: 53 significant plus one rounding bit
+  exp2 -= 1 ^ msb;
+  if (lo==0 && (hi & 0x1FF)==0 && (mant & 3)==1) return false;  // exactly half-way: round-to-even needs the full product
+  mant += mant & 1;
+  mant >>= 1;
+  if (mant >> 53) {  // rounding overflowed into a new bit
+    mant >>= 1;
+    exp2++;
+  }
+  if (exp2-1 >= 0x7FF-1) return false;  // subnormal, zero or infinite
+  const uint64_t bits = (exp2 << 52) | (mant & 0x000FFFFFFFFFFFFFULL) | (neg ? 0x8000000000000000ULL : 0);
+  memcpy(target, &bits, sizeof(double));
+  return true;
+}
 
 /**
  * Parse "usual" double literals, in the form
@@ -717,7 +1788,9 @@ static void parse_double_regular_core(const char **pch, double *target)
   // we will read and discard those extra digits, but only if they are followed
   // by a decimal point (otherwise it's a just big integer, which should be
   // treated as a string instead of losing precision).
+  bool truncated = false; // acc is not the exact decimal significand so only the long double path below may be used
   if (sflimit==0 && IS_DIGIT(*ch)) {
+    truncated = true;
     while (IS_DIGIT(*ch)) {
       ch++;
       e++;
@@ -750,7 +1823,8 @@ static void parse_double_regular_core(const char **pch, double *target)
     e -= k;
 
     // If more digits are present, skip them
-    if (sflimit==0) {
+    if (sflimit==0 && IS_DIGIT(*ch)) {
+      truncated = true;
       while (IS_DIGIT(*ch)) ch++;
     }
     // Check that at least 1 digit was present in either the integer or
@@ -787,6 +1861,25 @@ static void parse_double_regular_core(const char **pch, double *target)
   }
   if (e<-350 || e>350) return;
 
+  if (!truncated) {
+    // Exact fast paths. When acc and 10^|e| are both exact doubles a single IEEE multiply or divide is
+    // correctly rounded (Clinger 1990); this covers most prices and measurements. Otherwise try
+    // Eisel-Lemire which is correctly rounded too, and only rarely has to defer to long double below.
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD==0
+    if (acc <= (UINT64_C(1)<<53) && e >= -22 && e <= 22) {
+      double d = (double)acc;
+      d = e < 0 ? d/pow10exact[-e] : d*pow10exact[e];
+      *target = neg ? -d : d;
+      *pch = ch;
+      return;
+    }
+#endif
+    if (eisel_lemire(acc, e, neg, target)) {
+      *pch = ch;
+      return;
+    }
+  }
+
   long double r = (long double)acc;
   if (e < -300 || e > 300) {
     // Handle extra precision by pre-multiplying the result by pow(10, extra),
@@ -962,6 +2055,21 @@ rows = paste0(apply(matrix(t, ncol = 4L, byrow = TRUE), 1L, paste, collapse = ',
 cat(rows, sep='', file=f, append=TRUE)
 cat(146097, '// total days in 400 years\n};\n', sep = '', file=f, append=TRUE)
 */
+static int32_t days_since_epoch(int32_t year, int32_t month, int32_t day)
+{
+  // month has been checked to be in [1,12]; NA_INT32 when day isn't in the month
+  // Multiples of 4, excluding 3/4 of centuries
+  bool isLeapYear = year % 4 == 0 && (year % 100 != 0 || year/100 % 4 == 0);
+  if (day < 1 || (day > (isLeapYear ? leapYearDays[month-1] : normYearDays[month-1])))
+    return NA_INT32;
+
+  return
+    (year/400 - 4)*cumDaysCycleYears[400] + // days to beginning of 400-year cycle
+    cumDaysCycleYears[year % 400] + // days to beginning of year within 400-year cycle
+    (isLeapYear ? cumDaysCycleMonthsLeap[month-1] : cumDaysCycleMonthsNorm[month-1]) + // days to beginning of month within year
+    day-1; // day within month (subtract 1: 1970-01-01 -> 0)
+}
+
 static void parse_iso8601_date_core(const char **pch, int32_t *target)
 {
   const char *ch = *pch;
@@ -970,34 +2078,41 @@ static void parse_iso8601_date_core(const char **pch, int32_t *target)
 
   *target = NA_INT32;
 
-  str_to_i32_core(&ch, &year, true);
-
-  // .Date(.Machine$integer.max*c(-1, 1)):
-  //  -5877641-06-24 -- 5881580-07-11
-  //  rather than fiddle with dates within those terminal years (unlikely
-  //  to be showing up in data sets any time soon), just truncate towards 0
-  if (year == NA_INT32 || year < -5877640 || year > 5881579 || *ch != '-')
-    return;
+  if (IS_DIGIT(ch[0]) && IS_DIGIT(ch[1]) && IS_DIGIT(ch[2]) && IS_DIGIT(ch[3]) && ch[4]=='-' &&
+      IS_DIGIT(ch[5]) && IS_DIGIT(ch[6]) && ch[7]=='-' && IS_DIGIT(ch[8]) && IS_DIGIT(ch[9]) && !IS_DIGIT(ch[10])) {
+    // Fixed layout YYYY-MM-DD: by far the most common so avoid three str_to_i32_core() calls. The byte tests
+    // stop at the first mismatch so cannot read past the \0 at eof.
+    year = AS_DIGIT(ch[0])*1000 + AS_DIGIT(ch[1])*100 + AS_DIGIT(ch[2])*10 + AS_DIGIT(ch[3]);
+    month = AS_DIGIT(ch[5])*10 + AS_DIGIT(ch[6]);
+    day = AS_DIGIT(ch[8])*10 + AS_DIGIT(ch[9]);
+    if (month < 1 || month > 12)
+      return;
+    ch += 10;
+  } else {
+    str_to_i32_core(&ch, &year, true);
+
+    // .Date(.Machine$integer.max*c(-1, 1)):
+    //  -5877641-06-24 -- 5881580-07-11
+    //  rather than fiddle with dates within those terminal years (unlikely
+    //  to be showing up in data sets any time soon), just truncate towards 0
+    if (year == NA_INT32 || year < -5877640 || year > 5881579 || *ch != '-')
+      return;
+    ch++;
 
-  // Multiples of 4, excluding 3/4 of centuries
-  bool isLeapYear = year % 4 == 0 && (year % 100 != 0 || year/100 % 4 == 0);
-  ch++;
+    str_to_i32_core(&ch, &month, true);
+    if (month == NA_INT32 || month < 1 || month > 12 || *ch != '-')
+      return;
+    ch++;
 
-  str_to_i32_core(&ch, &month, true);
-  if (month == NA_INT32 || month < 1 || month > 12 || *ch != '-')
-    return;
-  ch++;
+    str_to_i32_core(&ch, &day, true);
+    if (day == NA_INT32)
+      return;
+  }
 
-  str_to_i32_core(&ch, &day, true);
-  if (day == NA_INT32 || day < 1 || (day > (isLeapYear ? leapYearDays[month-1] : normYearDays[month-1])))
+  *target = days_since_epoch(year, month, day);
+  if (*target == NA_INT32)
     return;
 
-  *target =
-    (year/400 - 4)*cumDaysCycleYears[400] + // days to beginning of 400-year cycle
-    cumDaysCycleYears[year % 400] + // days to beginning of year within 400-year cycle
-    (isLeapYear ? cumDaysCycleMonthsLeap[month-1] : cumDaysCycleMonthsNorm[month-1]) + // days to beginning of month within year
-    day-1; // day within month (subtract 1: 1970-01-01 -> 0)
-
   *pch = ch;
 }
 
@@ -1027,15 +2142,24 @@ static void parse_iso8601_timestamp(FieldParseContext *ctx)
   // allows date-only field in a column with UTC-marked datetimes to be parsed as UTC too; test 2150.13
   ch++;
 
-  str_to_i32_core(&ch, &hour, true);
-  if (hour == NA_INT32 || hour < 0 || hour > 23 || *ch != ':')
-    return;
-  ch++;
+  if (IS_DIGIT(ch[0]) && IS_DIGIT(ch[1]) && ch[2]==':' && IS_DIGIT(ch[3]) && IS_DIGIT(ch[4]) && ch[5]==':') {
+    // Fixed layout HH:MM: ; the seconds and any fraction go through parse_double_regular_core() below either way
+    hour = AS_DIGIT(ch[0])*10 + AS_DIGIT(ch[1]);
+    minute = AS_DIGIT(ch[3])*10 + AS_DIGIT(ch[4]);
+    if (hour > 23 || minute > 59)
+      return;
+    ch += 6;
+  } else {
+    str_to_i32_core(&ch, &hour, true);
+    if (hour == NA_INT32 || hour < 0 || hour > 23 || *ch != ':')
+      return;
+    ch++;
 
-  str_to_i32_core(&ch, &minute, true);
-  if (minute == NA_INT32 || minute < 0 || minute > 59 || *ch != ':')
-    return;
-  ch++;
+    str_to_i32_core(&ch, &minute, true);
+    if (minute == NA_INT32 || minute < 0 || minute > 59 || *ch != ':')
+      return;
+    ch++;
+  }
 
   parse_double_regular_core(&ch, &second);
   if (second == NA_FLOAT64 || second < 0 || second >= 60)
@@ -1082,6 +2206,179 @@ static void parse_iso8601_timestamp(FieldParseContext *ctx)
   *(ctx->ch) = ch;
 }
 
+static const char monthName[12][10] = {"january", "february", "march", "april", "may", "june", "july", "august", "september", "october", "november", "december"};
+
+/**
+ * Compile the strptime-style `fmt` of a CT_TIME_FORMAT column into `op`. Supported are %Y %y %m %d %e %H %I %M %S %OS
+ * (%OSn too) %b %B %h %p %z %F %T %R and %%, plus %s for seconds since the epoch (with any fraction) and %Q for
+ * milliseconds since the epoch. Returns false for any other directive, a format without the year or the epoch, or one
+ * too long.
+ */
+static bool compileTimeFormat(const char *fmt, timeFormatOp *op)
+{
+  // expand %F %T %R first
+  char buf[TF_MAXOP+1];
+  int k = 0;
+  for (const char *f=fmt; *f && k<TF_MAXOP; f++) {
+    const char *e = NULL;
+    if (*f=='%') e = f[1]=='F' ? "%Y-%m-%d" : (f[1]=='T' ? "%H:%M:%S" : (f[1]=='R' ? "%H:%M" : NULL));
+    if (e) {
+      for (; *e && k<TF_MAXOP; e++) buf[k++] = *e;
+      f++;
+    } else {
+      buf[k++] = *f;
+      if (*f=='%' && f[1] && k<TF_MAXOP) buf[k++] = *++f;  // so that %%F is % then F
+    }
+  }
+  if (k == TF_MAXOP) return false;
+  buf[k] = '\0';
+  int n = 0;
+  bool hasYear = false, hasEpoch = false;
+  for (const char *f=buf; *f; f++) {
+    if (*f != '%') { op[n++] = (timeFormatOp){TF_LIT, 0, *f}; continue; }
+    f++;
+    switch (*f) {
+    case '%': op[n++] = (timeFormatOp){TF_LIT, 0, '%'}; break;
+    case 'Y': op[n++] = (timeFormatOp){TF_YEAR, 4, 0}; hasYear = true; break;
+    case 'y': op[n++] = (timeFormatOp){TF_YEAR2, 2, 0}; hasYear = true; break;
+    case 'm': op[n++] = (timeFormatOp){TF_MONTH, 2, 0}; break;
+    case 'b': case 'B': case 'h': op[n++] = (timeFormatOp){TF_MONTHNAME, 0, 0}; break;
+    case 'd': op[n++] = (timeFormatOp){TF_DAY, 2, 0}; break;
+    case 'e': op[n++] = (timeFormatOp){TF_DAY, 2, ' '}; break;
+    case 'H': op[n++] = (timeFormatOp){TF_HOUR, 2, 0}; break;
+    case 'I': op[n++] = (timeFormatOp){TF_HOUR12, 2, 0}; break;
+    case 'p': op[n++] = (timeFormatOp){TF_AMPM, 0, 0}; break;
+    case 'M': op[n++] = (timeFormatOp){TF_MINUTE, 2, 0}; break;
+    case 'S': op[n++] = (timeFormatOp){TF_SECOND, 2, 0}; break;
+    case 'O':
+      if (f[1] != 'S') return false;
+      f++;
+      if (f[1]>='0' && f[1]<='6') f++;  // %OS3: the digits to print, which make no difference to reading
+      op[n++] = (timeFormatOp){TF_FSECOND, 2, 0};
+      break;
+    case 'z': op[n++] = (timeFormatOp){TF_TZ, 0, 0}; break;
+    case 's': op[n++] = (timeFormatOp){TF_EPOCH, 0, 0}; hasEpoch = true; break;
+    case 'Q': op[n++] = (timeFormatOp){TF_EPOCHMS, 0, 0}; hasEpoch = true; break;
+    default: return false;  // includes the \0 after a trailing %
+    }
+  }
+  op[n].step = TF_END;
+  return hasYear || hasEpoch;
+}
+
+/**
+ * Parse a CT_TIME_FORMAT field by following its column's compiled format. The time is UTC unless %z gives its offset; a
+ * format without %z, %s or %Q is only read here when times are UTC (tz="UTC"), see userOverride() in freadR.c.
+ * Numbers take up to the directive's width in digits, so layouts without separators such as "20240131 093000.123"
+ * work with "%Y%m%d %H%M%OS".
+ */
+static void parse_time_format(FieldParseContext *ctx)
+{
+  const char *ch = *(ctx->ch);
+  double *target = (double*) ctx->targets[sizeof(double)];
+  *target = NA_FLOAT64;
+
+  int32_t year=1970, month=1, day=1, hour=0, minute=0, tzMinutes=0, pm=-1;
+  double second=0, epoch=0;
+  bool isEpoch = false;
+  for (const timeFormatOp *op=timeFormat[ctx->col]; op->step!=TF_END; op++) {
+    switch (op->step) {
+    case TF_LIT:
+      if (*ch != op->lit) return;
+      ch++;
+      break;
+    case TF_MONTHNAME: {
+      int m = 0;
+      while (m<12 && ((ch[0]|0x20)!=monthName[m][0] || (ch[1]|0x20)!=monthName[m][1] || (ch[2]|0x20)!=monthName[m][2])) m++;
+      if (m == 12) return;
+      int len = 3;
+      while (monthName[m][len] && (ch[len]|0x20)==monthName[m][len]) len++;
+      ch += monthName[m][len] ? 3 : len;  // abbreviation or full name
+      month = m+1;
+      break;
+    }
+    case TF_AMPM:
+      if (((ch[0]|0x20)!='a' && (ch[0]|0x20)!='p') || (ch[1]|0x20)!='m') return;
+      pm = (ch[0]|0x20)=='p';
+      ch += 2;
+      break;
+    case TF_TZ: {
+      if (*ch == 'Z') { ch++; break; }
+      if (*ch != '+' && *ch != '-') return;
+      const int sign = *ch=='-' ? -1 : 1;
+      if (!IS_DIGIT(ch[1]) || !IS_DIGIT(ch[2])) return;
+      int32_t tzh = AS_DIGIT(ch[1])*10 + AS_DIGIT(ch[2]), tzm = 0;
+      ch += 3;
+      if (*ch == ':' && IS_DIGIT(ch[1])) ch++;
+      if (IS_DIGIT(ch[0]) && IS_DIGIT(ch[1])) { tzm = AS_DIGIT(ch[0])*10 + AS_DIGIT(ch[1]); ch += 2; }
+      if (tzh > 24 || tzm > 59) return;
+      tzMinutes = sign*(tzh*60 + tzm);
+      break;
+    }
+    case TF_EPOCH: case TF_EPOCHMS: {
+      const bool neg = *ch=='-';
+      ch += neg;
+      int64_t v = 0;
+      int nd = 0;
+      while (IS_DIGIT(ch[nd]) && nd<18) v = v*10 + AS_DIGIT(ch[nd++]);
+      if (!nd) return;
+      ch += nd;
+      epoch = op->step==TF_EPOCHMS ? (double)v / 1000 : (double)v;
+      if (op->step==TF_EPOCH && *ch=='.' && IS_DIGIT(ch[1])) {
+        int64_t frac = 0;
+        nd = 0;
+        for (ch++; IS_DIGIT(*ch); ch++) if (nd<9) { frac = frac*10 + AS_DIGIT(*ch); nd++; }
+        epoch += (double)frac / (double)pow10lookup[nd];
+      }
+      if (neg) epoch = -epoch;
+      isEpoch = true;
+      break;
+    }
+    default: {  // a number of up to op->width digits
+      int32_t v = 0;
+      int nd = 0;
+      if (op->lit==' ' && *ch==' ') ch++;
+      while (nd<op->width && IS_DIGIT(ch[nd])) v = v*10 + AS_DIGIT(ch[nd++]);
+      if (!nd) return;
+      ch += nd;
+      switch (op->step) {
+      case TF_YEAR: year = v; break;
+      case TF_YEAR2: year = v<69 ? 2000+v : 1900+v; break;  // as strptime
+      case TF_MONTH: month = v; break;
+      case TF_DAY: day = v; break;
+      case TF_HOUR: hour = v; if (hour > 23) return; break;
+      case TF_HOUR12: hour = v; if (hour < 1 || hour > 12) return; break;
+      case TF_MINUTE: minute = v; if (minute > 59) return; break;
+      case TF_SECOND: second = v; if (v > 59) return; break;
+      case TF_FSECOND:
+        if (v > 59) return;
+        second = v;
+        if (*ch == '.' && IS_DIGIT(ch[1])) {
+          int64_t frac = 0;
+          nd = 0;
+          for (ch++; IS_DIGIT(*ch); ch++) if (nd<9) { frac = frac*10 + AS_DIGIT(*ch); nd++; }
+          second += (double)frac / (double)pow10lookup[nd];
+        }
+        break;
+      }
+    }
+    }
+  }
+  if (isEpoch) {
+    *target = epoch;
+  } else {
+    if (month < 1 || month > 12)
+      return;
+    const int32_t date = days_since_epoch(year, month, day);
+    if (date == NA_INT32)
+      return;
+    if (pm >= 0) hour = hour%12 + 12*pm;  // %I with %p: 12AM is 0 and 12PM is 12
+    // cast upfront needed to prevent silent overflow
+    *target = 86400*(double)date + 3600*hour + 60*(minute - tzMinutes) + second;
+  }
+  *(ctx->ch) = ch;
+}
+
 static void parse_empty(FieldParseContext *ctx)
 {
   int8_t *target = (int8_t*) ctx->targets[sizeof(int8_t)];
@@ -1179,7 +2476,7 @@ static void parse_bool_yesno(FieldParseContext *ctx)
  */
 typedef void (*reader_fun_t)(FieldParseContext *ctx);
 static reader_fun_t fun[NUMTYPE] = {
-  (reader_fun_t) &Field,        // CT_DROP
+  (reader_fun_t) &skip_field,   // CT_DROP
   (reader_fun_t) &parse_empty,  // CT_EMPTY
   (reader_fun_t) &parse_bool_numeric,
   (reader_fun_t) &parse_bool_uppercase,
@@ -1193,6 +2490,7 @@ static reader_fun_t fun[NUMTYPE] = {
   (reader_fun_t) &parse_double_hexadecimal,
   (reader_fun_t) &parse_iso8601_date,
   (reader_fun_t) &parse_iso8601_timestamp,
+  (reader_fun_t) &parse_time_format,
   (reader_fun_t) &Field
 };
 
@@ -1259,22 +2557,550 @@ static int detect_types(const char **pch, int ncol, bool *bumped) {
       while (++tmpType[field]<CT_STRING && disabled_parsers[tmpType[field]]) {};
       *bumped = true;
     }
-    if (autoDec && dec != '\0') { // double was attempted
-      if (IS_DEC_TYPE(tmpType[field])) { // double succeeded
-        linesForDecDot += dec == '.' ? 1 : -1;
+    if (autoDec && dec != '\0') { // double was attempted
+      if (IS_DEC_TYPE(tmpType[field])) { // double succeeded
+        linesForDecDot += dec == '.' ? 1 : -1;
+      }
+      dec = '\0'; // reset for next parse
+    }
+    field++;
+    if (sep==' ' && *ch==sep) {
+      while (ch[1]==' ') ch++;
+      if (ch[1]=='\n' || ch[1]=='\r' || (ch[1]=='\0' && ch+1<eof)) ch++;  // space at the end of line does not mean sep
+    }
+    if (*ch!=sep || field==ncol) break;  // field==ncol is needed for 1753.2 where line ends with an extra comma but shouldn't, so shouldn't be moved over
+    ch++;
+  }
+  *pch = ch;
+  return field; // the number of fields so caller knows if ncol were read
+}
+
+
+/**
+ * Record the out-of-sample bump of column j to thisType (negative) due to the field at fieldStart, of which fieldLen bytes
+ * parsed as the new type, on the given row. Called by the reading threads.
+ */
+static void bumpType(int j, int8_t thisType, const char *fieldStart, int fieldLen, int64_t row, const char *colNamesAnchor,
+                     int *nTypeBump, int *nTypeBumpCols, char **typeBumpMsg, size_t *typeBumpMsgSize)
+{
+  #pragma omp critical
+  {
+    int8_t joldType = type[j];  // fetch shared value again in case another thread bumped it while I was waiting.
+    // Can't print because we're likely not master. So accumulate message and print afterwards.
+    if (thisType < joldType) {   // thisType<0 (type-exception)
+      if (args.verbose) {
+        char temp[1001];
+        int len = snprintf(temp, 1000,
+          _("Column %d%s%.*s%s bumped from '%s' to '%s' due to <<%.*s>> on row %"PRId64"\n"),
+          j+1, colNames?" <<":"", colNames?(colNames[j].len):0, colNames?(colNamesAnchor+colNames[j].off):"", colNames?">>":"",
+          typeName[IGNORE_BUMP(joldType)], typeName[IGNORE_BUMP(thisType)],
+          fieldLen, fieldStart, row);
+        if (len > 1000) len = 1000;
+        if (len > 0) {
+          *typeBumpMsg = realloc(*typeBumpMsg, *typeBumpMsgSize + len + 1);
+          strcpy(*typeBumpMsg + *typeBumpMsgSize, temp);
+          *typeBumpMsgSize += len;
+        }
+      }
+      (*nTypeBump)++;
+      if (joldType>0) (*nTypeBumpCols)++;
+      #pragma omp flush
+      type[j] = thisType;  // after nTypeBump so that a thread whose push skipped this column counts this bump when it records jumpRec.nbump
+    } // else another thread just bumped to a (negative) higher or equal type while I was waiting, so do nothing
+  }
+}
+
+// FNV-1a: hashes the JSON keys below and the detection cache's file contents and key
+#define FNV_OFFSET 0xCBF29CE484222325ULL
+static uint64_t fnv1a(uint64_t h, const void *p, size_t n)
+{
+  const uint8_t *b = (const uint8_t *)p;
+  for (size_t i=0; i<n; i++) h = (h ^ b[i]) * 0x100000001B3ULL;
+  return h;
+}
+
+
+//=================================================================================================
+//
+// JSON Lines
+//
+// With jsonl=true each line is a JSON object (also known as NDJSON). Its keys are the columns, found by sampling in [6]
+// and [7] as the types are, and each line's values are parsed by the reading threads into the columns of their keys with
+// the same parsers and out-of-sample type bumps as separated fields. A JSON string goes to a string column as the bytes
+// between its quotes (its escapes are left to the caller), and is only tried as a date or time otherwise; a nested object
+// or array goes to a string column as its JSON text. A key missing from a line is NA. Keys are compared decoded. When the
+// read meets a key that sampling did not find, it stops and freadMain returns 2 for the caller to read the input again
+// with fill=INT_MAX, which samples every line so that the key is a column too.
+//
+//=================================================================================================
+
+static inline const char *json_skip_white(const char *ch)
+{
+  while (*ch==' ' || *ch=='\t') ch++;
+  return ch;
+}
+
+/**
+ * The end of the JSON value starting at ch: the byte after its closing quote or bracket, or after the run of bytes of a
+ * number, true, false or null. NULL if the value does not end on this line.
+ */
+static const char *json_value_end(const char *ch)
+{
+  if (*ch=='"') {
+    for (ch++; *ch!='"'; ch++) {
+      if (*ch=='\\') ch++;  // moves over an escaped quote
+      if (*ch=='\n' || *ch=='\r' || ch>=eof) return NULL;
+    }
+    return ch+1;
+  }
+  if (*ch=='{' || *ch=='[') {
+    int depth = 0;
+    while (*ch!='\n' && *ch!='\r' && ch<eof) {
+      if (*ch=='"') {
+        if (!(ch = json_value_end(ch))) return NULL;
+        continue;
+      }
+      if (*ch=='{' || *ch=='[') depth++;
+      else if ((*ch=='}' || *ch==']') && --depth==0) return ch+1;
+      ch++;
+    }
+    return NULL;
+  }
+  const char *start = ch;
+  while (*ch!=',' && *ch!='}' && *ch!=']' && *ch!=' ' && *ch!='\t' && *ch!='\n' && *ch!='\r' && ch<eof) ch++;
+  return ch>start ? ch : NULL;
+}
+
+/**
+ * Move over the next key of an object from after its opening brace (first) or after the previous value, to its value.
+ * Returns 1 with the key's bytes between its quotes, 0 when the object has ended (after its closing brace), or -1 if the
+ * object is not valid JSON.
+ */
+static int json_key(const char **pch, const char **key, int *keyLen, bool first)
+{
+  const char *ch = json_skip_white(*pch);
+  if (*ch=='}') { *pch = ch+1; return 0; }
+  if (!first) {
+    if (*ch!=',') return -1;
+    ch = json_skip_white(ch+1);
+  }
+  if (*ch!='"') return -1;
+  const char *end = json_value_end(ch);
+  if (!end) return -1;
+  *key = ch+1;
+  *keyLen = (int)(end-ch-2);
+  ch = json_skip_white(end);
+  if (*ch!=':') return -1;
+  *pch = json_skip_white(ch+1);
+  return 1;
+}
+
+static inline int hex4(const char *s, const char *end)  // the value of 4 hex digits, -1 if not
+{
+  if (end-s<4) return -1;
+  int v = 0;
+  for (int k=0; k<4; k++) {
+    const char c = s[k];
+    v = v*16 + (c>='0' && c<='9' ? c-'0' : (c|0x20)>='a' && (c|0x20)<='f' ? (c|0x20)-'a'+10 : -65536);
+  }
+  return v<0 ? -1 : v;
+}
+
+int jsonDecode(const char *s, int len, char *dest)
+{
+  const char *end = s + len;
+  char *d = dest;
+  while (s<end) {
+    if (*s!='\\' || s+1==end) { *d++ = *s++; continue; }
+    s++;
+    switch (*s++) {
+    case 'b': *d++ = '\b'; break;
+    case 'f': *d++ = '\f'; break;
+    case 'n': *d++ = '\n'; break;
+    case 'r': *d++ = '\r'; break;
+    case 't': *d++ = '\t'; break;
+    case 'u': {
+      int cp = hex4(s, end), lo;
+      if (cp<=0) { *d++ = '\\'; *d++ = 'u'; break; }  // malformed, or \u0000 which R's strings cannot hold: kept as it is
+      s += 4;
+      if (cp>=0xD800 && cp<0xDC00 && end-s>=6 && s[0]=='\\' && s[1]=='u' && (lo=hex4(s+2, end))>=0xDC00 && lo<0xE000) {
+        cp = 0x10000 + ((cp-0xD800)<<10) + (lo-0xDC00);  // a surrogate pair is one code point
+        s += 6;
+      }
+      // at most 4 bytes of UTF-8 replace 6 or 12 bytes of escapes
+      if (cp<0x80) *d++ = (char)cp;
+      else if (cp<0x800) { *d++ = (char)(0xC0|cp>>6); *d++ = (char)(0x80|(cp&0x3F)); }
+      else if (cp<0x10000) { *d++ = (char)(0xE0|cp>>12); *d++ = (char)(0x80|(cp>>6&0x3F)); *d++ = (char)(0x80|(cp&0x3F)); }
+      else { *d++ = (char)(0xF0|cp>>18); *d++ = (char)(0x80|(cp>>12&0x3F)); *d++ = (char)(0x80|(cp>>6&0x3F)); *d++ = (char)(0x80|(cp&0x3F)); }
+      break;
+    }
+    default: *d++ = s[-1];  // \" \\ \/ and any other
+    }
+  }
+  return (int)(d-dest);
+}
+
+/**
+ * A key with escapes is decoded, so that "a\u0062" is the same key as "ab": into buf (JSON_KEYBUF bytes) when it fits,
+ * otherwise into *heap, which the caller frees. Returns the decoded key and sets *len to its length.
+ */
+#define JSON_KEYBUF 256
+static const char *json_decode_key(const char *key, int *len, char *buf, char **heap)
+{
+  if (!memchr(key, '\\', *len)) return key;
+  char *d = buf;
+  if (*len > JSON_KEYBUF) {
+    free(*heap);
+    if (!(d = *heap = malloc(*len))) return key;  // # nocov; compared as it is in the file
+  }
+  *len = jsonDecode(key, *len, d);
+  return d;
+}
+
+/**
+ * The column of the (decoded) key, or -1 if it was not found by sampling. Lines usually have their keys in the same order so the
+ * column after the previous key's (hint) is tried first.
+ */
+static int jsonColumn(const char *key, int len, int hint, int ncol)
+{
+  if (!ncol) return -1;
+  if (hint<ncol && colNames[hint].len==len && !memcmp(jsonKeys+colNames[hint].off, key, len)) return hint;
+  for (int slot=fnv1a(FNV_OFFSET, key, len) & (jsonSlots-1), j; (j=jsonSlot[slot]); slot=(slot+1) & (jsonSlots-1)) {
+    if (colNames[j-1].len==len && !memcmp(jsonKeys+colNames[j-1].off, key, len)) return j-1;
+  }
+  return -1;
+}
+
+/**
+ * Add a key found by sampling as the last column, with the lowest type.
+ */
+static void jsonAddKey(const char *key, int len, int *ncol, int8_t type0)
+{
+  const int j = (*ncol)++;
+  if (jsonKeysSize+len > jsonKeysAlloc) {
+    jsonKeysAlloc = 2*(jsonKeysSize+len) + 1024;
+    jsonKeys = realloc(jsonKeys, jsonKeysAlloc);
+  }
+  type = realloc(type, *ncol);
+  tmpType = realloc(tmpType, *ncol);
+  colNames = realloc(colNames, sizeof(*colNames) * (*ncol));
+  if (!jsonKeys || !type || !tmpType || !colNames)
+    STOP(_("Failed to allocate memory for %d JSON keys: %s"), *ncol, strerror(errno)); // # nocov
+  if (len) memcpy(jsonKeys+jsonKeysSize, key, len);
+  colNames[j] = (lenOff){ .len = len, .off = (int32_t)jsonKeysSize };
+  jsonKeysSize += len;
+  type[j] = tmpType[j] = type0;
+  if (2*(*ncol) > jsonSlots) {
+    free(jsonSlot);
+    jsonSlots = jsonSlots ? 2*jsonSlots : 64;
+    jsonSlot = calloc(jsonSlots, sizeof(*jsonSlot));
+    if (!jsonSlot)
+      STOP(_("Failed to allocate memory for %d JSON keys: %s"), *ncol, strerror(errno)); // # nocov
+    for (int k=0; k<*ncol; k++) {
+      int slot = fnv1a(FNV_OFFSET, jsonKeys+colNames[k].off, colNames[k].len) & (jsonSlots-1);
+      while (jsonSlot[slot]) slot = (slot+1) & (jsonSlots-1);
+      jsonSlot[slot] = k+1;
+    }
+  } else {
+    int slot = fnv1a(FNV_OFFSET, key, len) & (jsonSlots-1);
+    while (jsonSlot[slot]) slot = (slot+1) & (jsonSlots-1);
+    jsonSlot[slot] = j+1;
+  }
+}
+
+static inline bool json_null(const char *ch, const char *end)
+{
+  return end-ch==4 && ch[0]=='n' && ch[1]=='u' && ch[2]=='l' && ch[3]=='l';
+}
+
+/**
+ * Write NA of type t to ctx's target; for null and for keys missing from a line.
+ */
+static void json_na(FieldParseContext *ctx, int8_t t)
+{
+  switch (typeSize[t]) {
+  case 1: *(int8_t *)ctx->targets[1] = NA_BOOL8; break;
+  case 4: *(int32_t *)ctx->targets[4] = NA_INT32; break;
+  case 8:
+    if (t==CT_STRING) ((lenOff *)ctx->targets[8])->len = NA_LENOFF;
+    else if (t==CT_INT64) *(int64_t *)ctx->targets[8] = NA_INT64;
+    else *(double *)ctx->targets[8] = NA_FLOAT64;
+  }
+}
+
+/**
+ * Parse the JSON value from ch to end as type t into ctx's target. Returns false if it is not of that type.
+ */
+static bool json_value(FieldParseContext *ctx, const char *ch, const char *end, int8_t t)
+{
+  if (t==CT_DROP) return true;
+  if (t==CT_STRING) {
+    lenOff *target = (lenOff *)ctx->targets[8];
+    const bool quoted = *ch=='"';
+    target->off = (int32_t)(ch + quoted - ctx->anchor);
+    target->len = (int32_t)(end-ch - 2*quoted);
+    return true;
+  }
+  if (*ch=='{' || *ch=='[') return false;
+  if (*ch=='"') {
+    if (t<CT_ISO8601_DATE) return false;  // a quoted number is a string but a quoted date or time needn't be
+    ch++; end--;
+  }
+  *(ctx->ch) = ch;
+  fun[t](ctx);
+  return *(ctx->ch)==end && end>ch;
+}
+
+/**
+ * Sample one line for its keys, adding any new ones, and for the types of their values as detect_types() does for
+ * separated fields. Returns ncol, 0 for an empty line (resting on its eol) or -1 (resting on the line's start) if it is
+ * not a JSON object.
+ */
+static int detectJSONLine(const char **pch, int *ncol, int8_t type0, bool *bumped)
+{
+  const char *ch = json_skip_white(*pch);
+  if (*ch=='\n' || *ch=='\r' || ch==eof) { *pch = ch; return 0; }
+  if (*ch!='{') return -1;
+  double trash[2];
+  void *targets[9] = {NULL, trash, NULL, NULL, trash, NULL, NULL, NULL, trash};
+  const char *vch;
+  FieldParseContext fctx = {
+    .ch = &vch,
+    .targets = targets,
+    .anchor = ch,
+  };
+  ch++;
+  const char *key;
+  char keyBuf[JSON_KEYBUF], *keyHeap = NULL;
+  int keyLen, r, j = -1;
+  for (bool first=true; (r=json_key(&ch, &key, &keyLen, first))==1; first=false) {
+    const char *end = json_value_end(ch);
+    if (!end) { r = -1; break; }
+    key = json_decode_key(key, &keyLen, keyBuf, &keyHeap);
+    j = jsonColumn(key, keyLen, j+1, *ncol);
+    if (j<0) {
+      jsonAddKey(key, keyLen, ncol, type0);
+      j = *ncol-1;
+      *bumped = true;
+    }
+    if (!json_null(ch, end)) {
+      fctx.col = j;
+      while (!json_value(&fctx, ch, end, tmpType[j])) {
+        while (++tmpType[j]<CT_STRING && disabled_parsers[tmpType[j]]) {};
+        *bumped = true;
       }
-      dec = '\0'; // reset for next parse
-    }
-    field++;
-    if (sep==' ' && *ch==sep) {
-      while (ch[1]==' ') ch++;
-      if (ch[1]=='\n' || ch[1]=='\r' || (ch[1]=='\0' && ch+1<eof)) ch++;  // space at the end of line does not mean sep
     }
-    if (*ch!=sep || field==ncol) break;  // field==ncol is needed for 1753.2 where line ends with an extra comma but shouldn't, so shouldn't be moved over
-    ch++;
+    ch = end;
   }
+  free(keyHeap);
+  if (r<0) return -1;
+  ch = json_skip_white(ch);
+  if (*ch!='\n' && *ch!='\r' && ch!=eof) return -1;
   *pch = ch;
-  return field; // the number of fields so caller knows if ncol were read
+  return *ncol;
+}
+
+
+//=================================================================================================
+//
+// Fixed width
+//
+// With widths= there is no separator or quoting: the fields are at the same byte offsets on every line, so every line
+// ending ends a row and a line shorter than the others has NA in the fields it doesn't reach. Spaces padding a field are
+// not part of it (nor of a string when strip.white=TRUE). Fields are usually next to each other with no space between,
+// so a field is copied to a small NUL terminated buffer for the parsers; see fwf_value().
+//
+//=================================================================================================
+static inline const char *line_end(const char *ch)
+{
+  while ((ch=seek_structural(ch, '\n'))<eof && *ch!='\n' && *ch!='\r') ch++;  // step over \0 before eof
+  return ch;
+}
+
+// parse [ch,end) as type t into ctx's target; buff is FWF_BUFF bytes
+static bool fwf_value(FieldParseContext *ctx, const char *ch, const char *end, int8_t t, char *buff)
+{
+  if (t==CT_DROP) return true;
+  const char *fieldStart = ch, *fieldEnd = end;  // for strings when strip.white=FALSE
+  while (ch<end && *ch==' ') ch++;
+  while (end>ch && end[-1]==' ') end--;
+  const int len = (int)(end-ch);
+  if (len < FWF_BUFF-8) {  // -8 as the SWAR digit parsers load 8 bytes at a time
+    memcpy(buff, ch, len);
+    buff[len] = '\0';
+    if ((len==0 && (t!=CT_STRING || blank_is_a_NAstring)) || (len && end_NA_string(buff)==buff+len)) {
+      json_na(ctx, t);
+      return true;
+    }
+  } else if (t!=CT_STRING) {
+    return false;  // too long for anything but a string
+  }
+  if (t==CT_STRING) {
+    lenOff *target = (lenOff *)ctx->targets[8];
+    if (!stripWhite) { ch = fieldStart; end = fieldEnd; }
+    target->off = (int32_t)(ch - ctx->anchor);
+    target->len = (int32_t)(end-ch);
+    return true;
+  }
+  *(ctx->ch) = buff;
+  fun[t](ctx);
+  return *(ctx->ch)==buff+len;
+}
+
+// type detection of one line as detect_types() does; returns ncol or 0 for an empty line when skipEmptyLines. Leaves resting
+// on the eol
+static int detectFWFLine(const char **pch, int ncol, bool *bumped)
+{
+  const char *ch = *pch, *lineEnd = line_end(ch);
+  *pch = lineEnd;
+  if (lineEnd==ch && skipEmptyLines) return 0;
+  double trash[2];
+  void *targets[9] = {NULL, trash, NULL, NULL, trash, NULL, NULL, NULL, trash};
+  const char *vch;
+  FieldParseContext fctx = {
+    .ch = &vch,
+    .targets = targets,
+    .anchor = ch,
+  };
+  char buff[FWF_BUFF];
+  for (int j=0; j<ncol; j++) {
+    const char *start = ch+fwfStart[j], *end = start+fwfWidth[j];
+    if (end>lineEnd) end = lineEnd;
+    if (start>end) start = end;
+    fctx.col = j;
+    while (!fwf_value(&fctx, start, end, tmpType[j], buff)) {
+      while (++tmpType[j]<CT_STRING && disabled_parsers[tmpType[j]]) {};
+      *bumped = true;
+    }
+  }
+  return ncol;
+}
+
+
+//=================================================================================================
+//
+// Detection cache
+//
+// The separator, quote rule, column types, header, row count and chunk starts of a file read completely are saved to
+// args.cacheDir so that the next read of the same file skips sampling ([6] and [7]) and starts each thread on its chunk's
+// first line straight away. The cache file is named by a hash of the path; its key (cacheKey()) is checked when loading and
+// anything amiss just means the file is detected as usual.
+//
+//=================================================================================================
+static bool cachePath(char *path, size_t n)
+{
+  const uint64_t h = fnv1a(FNV_OFFSET, args.filename, strlen(args.filename));
+  return snprintf(path, n, "%s/fread-%016"PRIx64".cache", args.cacheDir, h) < (int)n;  // # notranslate
+}
+
+/**
+ * The key of the input's cache: its size, modification time, a hash of its first 64KB and a hash of the arguments which
+ * affect detection. Returns false if the file cannot be stat'ed.
+ */
+static bool cacheKey(cacheHeader *key)
+{
+  struct stat st;
+  if (stat(args.filename, &st)) return false;
+  memset(key, 0, sizeof(*key));
+  memcpy(key->magic, "FREADC2", 8);
+  key->fileSize = fileSize;
+  key->mtime = (int64_t)st.st_mtime;
+  // a file rewritten within the same second with the same size and start is told apart by the nanoseconds
+  #if defined(__APPLE__)
+    key->mtimeNsec = (int64_t)st.st_mtimespec.tv_nsec;
+  #elif !defined(WIN32) && defined(st_mtime)  // st_mtime is st_mtim.tv_sec on Linux and the BSDs
+    key->mtimeNsec = (int64_t)st.st_mtim.tv_nsec;
+  #endif
+  key->headHash = fnv1a(FNV_OFFSET, sof, umin(eof-sof, 64*1024));
+  uint64_t h = FNV_OFFSET;
+  const char flags[] = {args.sep, args.dec, args.quote, args.header, args.stripWhite, args.skipEmptyLines, args.keepLeadingZeros,
+                        args.noTZasUTC, args.skipString!=NULL};
+  h = fnv1a(h, flags, sizeof(flags));
+  h = fnv1a(h, &args.fill, sizeof(args.fill));
+  h = fnv1a(h, &args.skipNrow, sizeof(args.skipNrow));
+  if (args.skipString) h = fnv1a(h, args.skipString, strlen(args.skipString)+1);
+  for (const char * const* s=args.NAstrings; *s; s++) h = fnv1a(h, *s, strlen(*s)+1);
+  h = fnv1a(h, disabled_parsers, sizeof(disabled_parsers));
+  key->argsHash = h;
+  return true;
+}
+
+static uint64_t cacheSum(cacheHeader hd)
+{
+  hd.sum = 0;
+  uint64_t h = fnv1a(FNV_OFFSET, &hd, sizeof(hd));
+  h = fnv1a(h, cacheType, hd.ncol);
+  return fnv1a(h, cacheJump, sizeof(*cacheJump) * hd.nJumps);
+}
+
+/**
+ * Read the cache for this input into cacheHd, cacheType and cacheJump. Returns false, leaving nothing allocated, when there is
+ * none or it is for a different file, arguments or version of this file, or does not check out.
+ */
+static bool loadCache(const cacheHeader *key)
+{
+  char path[4096];
+  if (!cachePath(path, sizeof(path))) return false;
+  FILE *f = fopen(path, "rb");
+  if (!f) return false;
+  bool ok = fread(&cacheHd, sizeof(cacheHd), 1, f)==1 && !memcmp(cacheHd.magic, key->magic, sizeof(key->magic)) &&
+            cacheHd.fileSize==key->fileSize && cacheHd.mtime==key->mtime && cacheHd.mtimeNsec==key->mtimeNsec && cacheHd.headHash==key->headHash &&
+            cacheHd.argsHash==key->argsHash && cacheHd.ncol>1 && cacheHd.nJumps>0 && cacheHd.nrow>0 &&
+            cacheHd.pos>=0 && cacheHd.pos<eof-sof && cacheHd.bytesRead>0;
+  if (ok) {
+    cacheType = malloc(cacheHd.ncol);
+    cacheJump = malloc(sizeof(*cacheJump) * cacheHd.nJumps);
+    ok = cacheType && cacheJump &&
+         fread(cacheType, 1, cacheHd.ncol, f)==(size_t)cacheHd.ncol &&
+         fread(cacheJump, sizeof(*cacheJump), cacheHd.nJumps, f)==(size_t)cacheHd.nJumps &&
+         fgetc(f)==EOF && cacheSum(cacheHd)==cacheHd.sum;
+  }
+  fclose(f);
+  for (int j=0; ok && j<cacheHd.ncol; j++) ok = cacheType[j]>=CT_EMPTY && cacheType[j]<=CT_STRING && !disabled_parsers[cacheType[j]];
+  // each chunk must start a line, in case the file was changed without changing what the key checks
+  for (int i=0; ok && i<cacheHd.nJumps; i++) {
+    const int64_t j = cacheJump[i];
+    ok = j>=(i ? cacheJump[i-1] : cacheHd.pos) && j<=eof-sof && (j==0 || j==eof-sof || sof[j-1]=='\n' || sof[j-1]=='\r');
+  }
+  if (!ok) {
+    free(cacheType); cacheType = NULL;
+    free(cacheJump); cacheJump = NULL;
+  }
+  return ok;
+}
+
+/**
+ * Write cacheHd (completed by the caller), cacheType and the jump starts to the cache. They are written to a file of this
+ * process's own in the cache directory which is then renamed over the cache, so that another process reading or writing
+ * the same cache at the same time sees either the old one or the new one whole. A failure to write just leaves no cache.
+ */
+static void saveCache(int nJumps)
+{
+  char path[4096], tmp[4096+32];
+  free(cacheJump);
+  cacheJump = malloc(sizeof(*cacheJump) * nJumps);
+  if (!cacheJump || !cachePath(path, sizeof(path))) return;
+  for (int i=0; i<nJumps; i++) cacheJump[i] = jumpRec[i].start - sof;
+  cacheHd.nJumps = nJumps;
+  cacheHd.sum = cacheSum(cacheHd);
+  #ifdef WIN32
+    snprintf(tmp, sizeof(tmp), "%s.%lu.tmp", path, (unsigned long)GetCurrentProcessId());  // # notranslate
+  #else
+    snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", path, (long)getpid());  // # notranslate
+  #endif
+  FILE *f = fopen(tmp, "wb");
+  bool ok = f &&
+            fwrite(&cacheHd, sizeof(cacheHd), 1, f)==1 &&
+            fwrite(cacheType, 1, cacheHd.ncol, f)==(size_t)cacheHd.ncol &&
+            fwrite(cacheJump, sizeof(*cacheJump), nJumps, f)==(size_t)nJumps;
+  if (f && fclose(f)) ok = false;
+  #ifdef WIN32
+    ok = ok && MoveFileExA(tmp, path, MOVEFILE_REPLACE_EXISTING);  // rename() doesn't replace an existing file on Windows
+  #else
+    ok = ok && !rename(tmp, path);
+  #endif
+  if (!ok && f) remove(tmp);
+  if (args.verbose) DTPRINT(ok ? _("  Saved the detection to the cache %s\n") : _("  Could not write the cache %s\n"), path);
 }
 
 
@@ -1355,6 +3181,7 @@ int freadMain(freadMainArgs _args) {
   disabled_parsers[CT_BOOL8_N] = !args.logical01;
   disabled_parsers[CT_BOOL8_Y] = !args.logicalYN;
   disabled_parsers[CT_ISO8601_DATE] = disabled_parsers[CT_ISO8601_TIME] = args.oldNoDateTime; // temporary new option in v1.13.0; see NEWS
+  disabled_parsers[CT_TIME_FORMAT] = true;  // needs the column's format so only ever set by userOverride(); a field that doesn't match bumps to string
   if (verbose) {
     if (*NAstrings == NULL) {
       DTPRINT(_("  No NAstrings provided.\n"));
@@ -1382,6 +3209,8 @@ int freadMain(freadMainArgs _args) {
   stripWhite = args.stripWhite;
   skipEmptyLines = args.skipEmptyLines;
   fill = args.fill;
+  jsonl = args.jsonl;
+  fwf = args.nwidths>0;
   dec = args.dec;
   quote = args.quote;
   if (args.sep == quote && quote!='\0') STOP(_("sep == quote ('%c') is not allowed"), quote);
@@ -1405,16 +3234,50 @@ int freadMain(freadMainArgs _args) {
   {
   if (verbose) DTPRINT(_("[02] Opening the file\n"));
   mmp = NULL;
+  bool spilled = false;  // the output of cmd was too large to keep in memory and is mapped from the file it was written to
+  if (args.cmd) {
+    int status = 0;
+    if (verbose) DTPRINT(_("  Reading the output of command: %s\n"), args.cmd);
+    if (args.rangeStart>0 || args.rangeEnd<INT64_MAX) STOP(_("byte_range= can only be used to read a file"));
+    const double tt = wallclock();
+    spilled = readPipe(args.cmd, args.cmdSpill, args.cmdMax, &status);
+    if (verbose) {
+      if (spilled) DTPRINT(_("  Output passed %s so it was written to a temporary file in %.3fs\n"), filesize_to_str(args.cmdMax), wallclock()-tt);
+      else DTPRINT(_("  Read %s from the pipe in %.3fs\n"), filesize_to_str(fileSize), wallclock()-tt);
+    }
+    #ifdef WIN32
+      const int code = status==-1 ? 0 : status;  // _pclose() returns the exit code itself
+    #else
+      const int code = status!=-1 && WIFEXITED(status) ? WEXITSTATUS(status) : 0;
+    #endif
+    if (code) {
+      if (!spilled && fileSize==0) STOP(_("Command produced no output and exited with status %d: %s"), code, args.cmd);
+      DTWARN(_("Command exited with status %d, so its output may be incomplete: %s"), code, args.cmd);
+    }
+    if (!spilled && fileSize==0) STOP(_("Command produced no output: %s"), args.cmd);
+  }
   if (args.input) {
     if (verbose) DTPRINT(_("  `input` argument is provided rather than a file name, interpreting as raw text to read\n"));
+    if (args.rangeStart>0 || args.rangeEnd<INT64_MAX) STOP(_("byte_range= can only be used to read a file"));
     sof = args.input;
     fileSize = strlen(sof);
     eof = sof+fileSize;
     if (*eof!='\0') INTERNAL_STOP("last byte of character input isn't \\0"); // # nocov
   }
-  else if (args.filename) {
-    if (verbose) DTPRINT(_("  Opening file %s\n"), args.filename);
-    const char* fnam = args.filename;
+  else if (args.nfile>1) {
+    if (args.rangeStart>0 || args.rangeEnd<INT64_MAX) STOP(_("byte_range= can only be used to read one file"));
+    const double tt = wallclock();
+    const int nhdr = readFiles(args.filenames, args.nfile, args.header!=false && !jsonl, nth);
+    sof = (const char*) mmp_copy;
+    if (verbose) DTPRINT(_("  %d files read by %d threads into one input of %s in %.3fs; the first line of %d of them repeated the first file's and was skipped\n"),
+                         args.nfile, nth, filesize_to_str(fileSize), wallclock()-tt, nhdr);
+  }
+  else if (args.cmd && !spilled) {
+    sof = (const char*) mmp_copy;
+  }
+  else if (args.filename || spilled) {
+    const char* fnam = spilled ? args.cmdSpill : args.filename;
+    if (verbose) DTPRINT(_("  Opening file %s\n"), fnam);
     #ifndef WIN32
       int fd = open(fnam, O_RDONLY);
       if (fd==-1) STOP(_("Couldn't open file %s: %s"),fnam, strerror(errno));
@@ -1431,11 +3294,39 @@ int freadMain(freadMainArgs _args) {
       if (fileSize == 0) {close(fd); STOP(_("File is empty: %s"), fnam);}
       if (verbose) DTPRINT(_("  File opened, size = %s.\n"), filesize_to_str(fileSize));
 
-      // No MAP_POPULATE for faster nrows=10 and to make possible earlier progress bar in row count stage
+      pageSize = (size_t)sysconf(_SC_PAGESIZE);
+      const int mode = args.inputMode;
+      const bool wholeFile = args.rangeStart==0 && args.rangeEnd==INT64_MAX && nrowLimit==INT64_MAX;
+      if (mode==INPUT_READ && wholeFile) {
+        const double tt = wallclock();
+        readFile(fd, fnam, nth);
+        sof = (const char*) mmp_copy;
+        if (verbose) DTPRINT(_("  Read into memory by %d threads in %.3fs (datatable.fread.input=\"read\")\n"), nth, wallclock()-tt);
+        goto mapped;
+      }
+      // No MAP_POPULATE by default for faster nrows=10 and to make possible earlier progress bar in row count stage
       // Mac doesn't appear to support MAP_POPULATE anyway (failed on CRAN when I tried).
-      // TO DO?: MAP_HUGETLB for Linux but seems to need admin to setup first. My Hugepagesize is 2MB (>>2KB, so promising)
-      //         https://www.kernel.org/doc/Documentation/vm/hugetlbpage.txt
-      mmp = mmap(NULL, fileSize, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);  // COW for last page lastEOLreplaced
+      // The modes other than INPUT_MMAP are for reading the whole of a large file from a cold cache, where faulting pages in
+      // one at a time is slow. MAP_HUGETLB needs huge pages set aside by the administrator so MADV_HUGEPAGE is used instead.
+      int flags = MAP_PRIVATE;
+      #ifdef MAP_POPULATE
+        if (mode==INPUT_POPULATE && wholeFile) flags |= MAP_POPULATE;
+      #endif
+      mmp = mmap(NULL, fileSize, PROT_READ|PROT_WRITE, flags, fd, 0);  // COW for last page lastEOLreplaced
+      if (mmp != MAP_FAILED && mode!=INPUT_MMAP) {
+        // advice only: a kernel without it carries on as usual
+        #ifdef MADV_SEQUENTIAL
+          if (mode==INPUT_SEQUENTIAL || mode==INPUT_HUGEPAGE) madvise(mmp, fileSize, MADV_SEQUENTIAL);
+        #endif
+        #ifdef MADV_HUGEPAGE
+          if (mode==INPUT_HUGEPAGE) madvise(mmp, fileSize, MADV_HUGEPAGE);
+        #endif
+        #if !defined(MAP_POPULATE) && defined(MADV_WILLNEED)
+          if (mode==INPUT_POPULATE && wholeFile) madvise(mmp, fileSize, MADV_WILLNEED);
+        #endif
+        readAhead = mode==INPUT_SEQUENTIAL || mode==INPUT_HUGEPAGE;
+        if (verbose) DTPRINT(_("  datatable.fread.input=\"%s\"\n"), mode==INPUT_SEQUENTIAL ? "sequential" : mode==INPUT_POPULATE ? "populate" : mode==INPUT_HUGEPAGE ? "hugepage" : "read");
+      }
       #ifdef __EMSCRIPTEN__
         mmp_fd = fd;
       #else
@@ -1479,8 +3370,32 @@ int freadMain(freadMainArgs _args) {
     }
     sof = (const char*) mmp;
     if (verbose) DTPRINT(_("  Memory mapped ok\n"));
+    #ifndef WIN32
+    mapped:;
+    #endif
   } else {
-    INTERNAL_STOP("neither `input` nor `filename` are given, nothing to read"); // # nocov
+    INTERNAL_STOP("neither `input`, `filename` nor `cmd` are given, nothing to read"); // # nocov
+  }
+  if (args.cmd && fileSize>=10 && (!memcmp(sof, "\x28\xB5\x2F\xFD", 4) || !memcmp(sof, "PK\x03\x04", 4) || (!memcmp(sof, "BZh", 3) && !memcmp(sof+4, "1AY&SY", 6))))
+    STOP(_("The output of the command is zstd, zip or bzip2 compressed, which fread() cannot read from a pipe (gzip it can). Please decompress it within the command: %s"), args.cmd);
+  if (!args.input && fileSize>=18 && (uint8_t)sof[0]==0x1F && (uint8_t)sof[1]==0x8B && sof[2]==8) {
+    const char *fnam = args.cmd ? args.cmd : args.filename;
+    #ifdef NOZLIB
+      STOP(_("File is gzip compressed but zlib was not available when data.table was compiled: %s"), fnam); // # nocov
+    #else
+      const double tt = wallclock();
+      const size_t compressedSize = fileSize;
+      if (mmp_copy) { mmp_pipe = mmp_copy; mmp_copy = NULL; }  // the output of cmd, or a file read rather than mapped
+      const int64_t nblock = inflateFile((const uint8_t *)sof, fnam, nth);
+      sof = (const char*) mmp_copy;
+      if (verbose) {
+        if (nblock) DTPRINT(_("  File is BGZF compressed: %"PRId64" blocks inflated in parallel by %d threads to %s (%.1f times larger) in %.3fs\n"),
+                            nblock, nth, filesize_to_str(fileSize), (double)fileSize/compressedSize, wallclock()-tt);
+        else DTPRINT(_("  File is gzip compressed: inflated by one thread to %s (%.1f times larger) in %.3fs\n"),
+                     filesize_to_str(fileSize), (double)fileSize/compressedSize, wallclock()-tt);
+      }
+      if (fileSize == 0) STOP(_("File is empty: %s"), fnam);
+    #endif
   }
   eof = sof + fileSize;
   tMap = wallclock();
@@ -1535,7 +3450,7 @@ int freadMain(freadMainArgs _args) {
     _("  \\n has been found in the input and different lines can end with different line endings (e.g. mixed \\n and \\r\\n in one file). This is common and ideal.\n"));
 
   bool lastEOLreplaced = false;
-  if (args.filename) {
+  if (!args.input) {
     // eof is currently resting after the last byte of the file (so don't even read it there; bus error if fileSize%4096==0)
     ch = eof-1;
     if (eol_one_r) {
@@ -1555,7 +3470,7 @@ int freadMain(freadMainArgs _args) {
     }
     if (!lastEOLreplaced) {
       // very unusual branch because properly formed csv will have final eol
-      if (fileSize%4096!=0) {
+      if (fileSize%4096!=0 || mmp_copy) {  // mmp_copy here is an inflated gzip file, which has the extra byte already
         if (verbose) DTPRINT(_("  File ends abruptly with '%c'. Final end-of-line is missing. Using cow page to write 0 to the last byte.\n"), eof[-1]);
         // We could do this routinely (i.e. when there is a final newline too) but we desire to run all tests through the harder
         // branch above that replaces the final newline with \0 to test that logic (e.g. test 893 which causes a type bump in the last
@@ -1673,10 +3588,78 @@ int freadMain(freadMainArgs _args) {
     jumpLines = INT_MAX;
     fill = 1; // set fill to true value to not overallocate
   }
-  {
+  // what an earlier read of the same file with the same arguments found in [6] and [7], see loadCache()
+  cacheHeader cacheKeyHd;
+  const bool useCache = args.cacheDir && args.filename && args.nfile<=1 && !jsonl && !fwf && nrowLimit==INT64_MAX && args.rangeStart==0 && args.rangeEnd==INT64_MAX &&
+                        cacheKey(&cacheKeyHd);
+  const bool cacheHit = useCache && loadCache(&cacheKeyHd);
+  bool cacheStale = !cacheHit;  // save the cache after reading
+  if (cacheHit) {
+    if (verbose) DTPRINT(_("[06] Separator, quoting rule, and ncolumns from the cache\n"));
+    sep = cacheHd.sep;
+    whiteChar = (sep==' ' ? '\t' : (sep=='\t' ? ' ' : 0));
+    quoteRule = cacheHd.quoteRule;
+    ncol = cacheHd.ncol;
+    fill = cacheHd.fill;
+    pos = sof + cacheHd.pos;
+    row1line = cacheHd.row1line;
+    if (verbose) DTPRINT(_("  %d columns on line %d. Quote rule %d\n"), ncol, row1line, quoteRule);
+  } else {
   if (verbose) DTPRINT(_("[06] Detect separator, quoting rule, and ncolumns\n"));
 
-  if (args.sep == '\n') {  // '\n' because '\0' is taken already to mean 'auto'
+  if (jsonl) {
+    if (verbose) DTPRINT(_("  jsonl=true: each line is a JSON object whose keys are the columns\n"));
+    sep = ',';
+    whiteChar = 0;
+    quote = '"';
+    dec = '.';
+    quoteRule = 3;          // there is no quoted field to span lines: a JSON string cannot contain a raw newline
+    skipEmptyLines = true;
+    fill = 0;
+    args.header = false;    // the column names are the keys, see [8]
+    ncol = 0;
+    int8_t type0 = 1;
+    while (disabled_parsers[type0]) type0++;
+    bool bumped = false;
+    int thisLine=0;
+    while (ch<eof && thisLine++<jumpLines) {
+      if (detectJSONLine(&ch, &ncol, type0, &bumped) < 0) {
+        if (thisLine==1) STOP(_("jsonl=TRUE but line %d is not a JSON object on one line: <<%s>>"), row1line, strlim(ch, 500));
+        break;  // the read will stop early there with a warning
+      }
+      if (eol(&ch)) ch++;
+    }
+    firstJumpEnd = ch;
+    ch = pos;
+    if (ncol==0) STOP(_("jsonl=TRUE but the objects on the first %d lines have no keys"), thisLine-1);
+  } else if (fwf) {
+    if (verbose) DTPRINT(_("  widths= supplied so each line is %d fixed width fields\n"), args.nwidths);
+    sep = 127;      // as for sep='\n' below, though fields are not separated
+    whiteChar = 0;
+    quote = '\0';
+    if (dec=='\0') dec = '.';
+    quoteRule = 3;  // no quoting
+    skipEmptyLines = true;  // an empty line has no fields at any offset; commonly a trailing one
+    fwfStart = malloc(sizeof(*fwfStart) * args.nwidths);
+    fwfWidth = malloc(sizeof(*fwfWidth) * args.nwidths);
+    if (!fwfStart || !fwfWidth)
+      STOP(_("Failed to allocate 2 x %d ints for widths: %s"), args.nwidths, strerror(errno)); // # nocov
+    ncol = 0;
+    for (int i=0, off=0; i<args.nwidths; i++) {
+      const int w = args.widths[i];
+      if (w==0 || w==INT32_MIN) STOP(_("widths[%d] is %d; each width must be positive or, to skip bytes, negative"), i+1, w);
+      if (w>0) { fwfStart[ncol] = off; fwfWidth[ncol] = w; ncol++; }
+      off += abs(w);
+    }
+    if (ncol==0) STOP(_("widths= skips every byte of the line; at least one width must be positive"));
+    int thisLine=0;
+    while (ch<eof && thisLine++<jumpLines) {
+      ch = line_end(ch);
+      if (eol(&ch)) ch++;
+    }
+    firstJumpEnd = ch;
+    ch = pos;
+  } else if (args.sep == '\n') {  // '\n' because '\0' is taken already to mean 'auto'
     // unusual
     if (verbose) DTPRINT(_("  sep='\\n' passed in meaning read lines as single character column\n"));
     sep = 127;     // ASCII DEL: a character different from \r, \n and \0 that isn't in the data
@@ -1837,7 +3820,7 @@ int freadMain(freadMainArgs _args) {
   }
 
   if (ncol<1 || row1line<1) INTERNAL_STOP("ncol==%d line==%d after detecting sep, ncol and first line", ncol, row1line); // # nocov
-  int tt = countfields(&ch);
+  int tt = jsonl || fwf ? ncol : countfields(&ch);
   ch = pos; // move back to start of line since countfields() moved to next
   if (!fill && tt!=ncol) INTERNAL_STOP("first line has field count %d but expecting %d", tt, ncol); // # nocov
   if (verbose) {
@@ -1847,9 +3830,9 @@ int freadMain(freadMainArgs _args) {
     DTPRINT(_("  fill=%s and the most number of columns found is %d\n"), fill?"true":"false", ncol);
   }
 
-  if (ncol==1 && lastEOLreplaced && (eof[-1]=='\n' || eof[-1]=='\r')) {
+  if (ncol==1 && !jsonl && !fwf && lastEOLreplaced && (eof[-1]=='\n' || eof[-1]=='\r')) {
     // Multiple newlines at the end are significant in the case of 1-column files only (multiple NA at the end)
-    if (fileSize%4096==0) {
+    if (fileSize%4096==0 && !mmp_copy) {
       const char *msg = _("This file is very unusual: it's one single column, ends with 2 or more end-of-line (representing several NA at the end), and the file size is a multiple of 4096, too");
       if (verbose)
         DTPRINT(_("  Copying file in RAM. %s\n"), msg);
@@ -1887,16 +3870,36 @@ int freadMain(freadMainArgs _args) {
   int64_t allocnrow=0;     // Number of rows in the allocated DataTable
   double meanLineLen=0.0; // Average length (in bytes) of a single line in the input file
   ptrdiff_t bytesRead=0;     // Bytes in the data section (i.e. excluding column names, header and footer, if any)
-  {
+  if (cacheHit) {
+    if (verbose) DTPRINT(_("[07] Column types, dec, nrow and whether first row is column names from the cache\n"));
+    type =    malloc(sizeof(*type) * ncol);
+    tmpType = malloc(sizeof(*tmpType) * ncol);
+    if (!type || !tmpType) {
+      free(type); free(tmpType); // # nocov
+      STOP(_("Failed to allocate 2 x %d bytes for type and tmpType: %s"), ncol, strerror(errno)); // # nocov
+    }
+    memcpy(type, cacheType, ncol);
+    dec = cacheHd.dec;
+    args.header = cacheHd.header;
+    autoFirstColName = cacheHd.autoFirstColName;
+    nJumps = cacheHd.nJumps;
+    sampleLines = 0;
+    bytesRead = cacheHd.bytesRead;
+    estnrow = allocnrow = cacheHd.nrow;
+    meanLineLen = (double)bytesRead/allocnrow;
+    if (verbose) DTPRINT(_("  Type codes (cache)        : %s  header=%s  nrow=%"PRId64"\n"), typesAsString(ncol), args.header?"true":"false", allocnrow);
+  } else {
   if (verbose) DTPRINT(_("[07] Detect column types, dec, good nrow estimate and whether first row is column names\n"));
   if (verbose && args.header!=NA_BOOL8) DTPRINT(_("  'header' changed by user from 'auto' to %s\n"), args.header?"true":"false");
 
+  if (!jsonl) {  // with jsonl, [6] made them as it found the keys, and the keys the jumps below find are added
   type =    malloc(sizeof(*type) * ncol);
   tmpType = malloc(sizeof(*tmpType) * ncol);  // used i) in sampling to not stop on errors when bad jump point and ii) when accepting user overrides
   if (!type || !tmpType) {
     free(type); free(tmpType); // # nocov
     STOP(_("Failed to allocate 2 x %d bytes for type and tmpType: %s"), ncol, strerror(errno)); // # nocov
   }
+  }
 
   if (sep == ',' && dec == '\0') { // if sep=',' detected, don't attempt to detect dec [NB: . is not par of seps]
     if (verbose) {
@@ -1907,7 +3910,7 @@ int freadMain(freadMainArgs _args) {
 
   int8_t type0 = 1;
   while (disabled_parsers[type0]) type0++;
-  for (int j=0; j<ncol; j++) {
+  if (!jsonl) for (int j=0; j<ncol; j++) {
     // initialize with the lowest available type
     tmpType[j] = type[j] = type0;
   }
@@ -1945,7 +3948,8 @@ int freadMain(freadMainArgs _args) {
     if (jump==0) {
       ch = pos;
       if (args.header!=false) {
-        countfields(&ch); // skip first row for type guessing as it's probably column names
+        if (fwf) { ch = line_end(ch); if (eol(&ch)) ch++; }
+        else countfields(&ch); // skip first row for type guessing as it's probably column names
         row1line++;
       }
       firstRowStart = ch;
@@ -1962,7 +3966,8 @@ int freadMain(freadMainArgs _args) {
 
     while(ch<eof && jumpLine++<jumpLines) {
       const char *lineStart = ch;
-      int thisNcol = detect_types(&ch, ncol, &bumped);
+      int thisNcol = jsonl ? detectJSONLine(&ch, &ncol, type0, &bumped) :
+                     fwf ? detectFWFLine(&ch, ncol, &bumped) : detect_types(&ch, ncol, &bumped);
       if (thisNcol==0 && skipEmptyLines) {
         if (eol(&ch)) ch++;
         continue;
@@ -2017,7 +4022,8 @@ int freadMain(freadMainArgs _args) {
     if (dec == '\0') { // in files without jumps, dec could still be undecided
       linesForDecDot = 0;
     }
-    detect_types(&ch, ncol, &bumped);
+    if (fwf) detectFWFLine(&ch, ncol, &bumped);
+    else detect_types(&ch, ncol, &bumped);
     if (dec == '\0') {
       dec = linesForDecDot < 0 ? ',' : '.';
       if (verbose) {
@@ -2102,6 +4108,15 @@ int freadMain(freadMainArgs _args) {
     }
     if (verbose && bumped) DTPRINT(_("  Type codes (first row)   : %s  Quote rule %d\n"), typesAsString(ncol), quoteRule);
   }
+  if (fileHdr && args.header==false) {
+    // header="auto" found the first line to be data, so the files whose first line repeated it start with a row too
+    const int64_t len = strlen(fileHdr)+1;
+    const int n = unskipFirstLines(args.nfile, eol_one_r ? '\r' : '\n', &pos, &firstRowStart);
+    sampleLines += n;  // the same line as the first row, which has been sampled
+    sumLen += (double)n*len;
+    sumLenSq += (double)n*len*len;
+    if (verbose) DTPRINT(_("  The first line of %d files, which repeated the first file's and was skipped, is data so has been put back\n"), n);
+  }
 
   estnrow=1;
   allocnrow=0;     // Number of rows in the allocated DataTable
@@ -2138,6 +4153,23 @@ int freadMain(freadMainArgs _args) {
     estnrow = allocnrow = nrowLimit;
   }
   }
+  if (useCache && !cacheHit) {
+    // what [6] and [7] found, saved with the row count and chunk starts once the file has been read
+    cacheHd = cacheKeyHd;
+    cacheHd.pos = pos - sof;
+    cacheHd.row1line = row1line;
+    cacheHd.ncol = ncol;
+    cacheHd.fill = fill;
+    cacheHd.sep = sep;
+    cacheHd.dec = dec;
+    cacheHd.header = args.header;
+    cacheHd.autoFirstColName = autoFirstColName;
+    cacheHd.bytesRead = bytesRead;
+    cacheType = malloc(ncol);
+    if (!cacheType)
+      STOP(_("Failed to allocate %zu bytes for '%s'."), (size_t)ncol, "cacheType"); // # nocov
+    memcpy(cacheType, type, ncol);
+  }
 
   //*********************************************************************************************
   // [8] Assign column names
@@ -2150,8 +4182,28 @@ int freadMain(freadMainArgs _args) {
 
   ch = pos;  // back to start of first row (column names if header==true)
 
-  if (args.header==false) {
+  if (jsonl) {
+    colNamesAnchor = jsonKeys;  // colNames were made from the keys by sampling
+    if (verbose) DTPRINT(_("  %d keys found by sampling\n"), ncol);
+  } else if (args.header==false) {
     colNames = NULL;  // userOverride will assign V1, V2, etc
+  } else if (fwf) {
+    colNames = calloc(ncol, sizeof(*colNames));
+    if (!colNames)
+      STOP(_("Unable to allocate %d*%d bytes for column name pointers: %s"), ncol, sizeof(*colNames), strerror(errno)); // # nocov
+    const char *lineEnd = line_end(ch);
+    for (int j=0; j<ncol; j++) {
+      // the names are at the same offsets as the fields, without the spaces padding them
+      const char *start = ch+fwfStart[j], *end = start+fwfWidth[j];
+      if (end>lineEnd) end = lineEnd;
+      if (start>end) start = end;
+      while (start<end && *start==' ') start++;
+      while (end>start && end[-1]==' ') end--;
+      colNames[j] = (lenOff){.len=(int32_t)(end-start), .off=(int32_t)(start-colNamesAnchor)};
+    }
+    ch = lineEnd;
+    if (eol(&ch)) ch++;
+    pos = ch;
   } else {
     colNames = calloc(ncol, sizeof(*colNames));
     if (!colNames)
@@ -2215,7 +4267,7 @@ int freadMain(freadMainArgs _args) {
   nNonStringCols = 0;
   for (int j=0; j<ncol; j++) {
     if (type[j]==CT_DROP) { size[j]=0; ndrop++; continue; }
-    if (type[j]<tmpType[j]) {
+    if (type[j]<tmpType[j] && type[j]!=CT_TIME_FORMAT) {  // a format is applied whatever was detected; e.g. "31/01/2024" is a string
       if (strcmp(typeName[tmpType[j]], typeName[type[j]]) != 0) {
         DTWARN(_("Attempt to override column %d%s%.*s%s of inherent type '%s' down to '%s' ignored. Only overrides to a higher type are currently supported. If this was intended, please coerce to the lower type afterwards."),
                j+1, colNames?" <<":"", colNames?(colNames[j].len):0, colNames?(colNamesAnchor+colNames[j].off):"", colNames?">>":"", // #4644
@@ -2233,18 +4285,187 @@ int freadMain(freadMainArgs _args) {
     if (type[j] == CT_STRING) nStringCols++; else nNonStringCols++;
   }
   if (verbose) DTPRINT(_("  After %d type and %d drop user overrides : %s\n"), nUserBumped, ndrop, typesAsString(ncol));
+  for (int j=0; j<ncol; j++) {
+    if (type[j]!=CT_TIME_FORMAT) continue;
+    if (!timeFormat) {
+      timeFormat = calloc(ncol, sizeof(*timeFormat));
+      if (!timeFormat)
+        STOP(_("Failed to allocate %zu bytes for '%s': %s"), ncol * sizeof(*timeFormat), "timeFormat", strerror(errno)); // # nocov
+    }
+    const char *fmt = colTimeFormat(j);
+    if (!compileTimeFormat(fmt, timeFormat[j]))
+      STOP(_("The time format '%s' of column %d%s%.*s%s is not supported. It must contain the year (%%Y or %%y) or the time since the epoch (%%s or %%Q) and otherwise only %%m %%d %%e %%b %%B %%H %%I %%p %%M %%S %%OS %%z %%F %%T %%R, %%%% and other characters to match as they are."),
+           fmt, j+1, colNames?" <<":"", colNames?(colNames[j].len):0, colNames?(colNamesAnchor+colNames[j].off):"", colNames?">>":"");
+    if (verbose) DTPRINT(_("  Column %d is read as a time in format '%s'\n"), j+1, fmt);
+  }
   tColType = wallclock();
   }
 
   //*********************************************************************************************
   // [10] Allocate the result columns
   //*********************************************************************************************
+  if (args.rangeStart>0 || args.rangeEnd<INT64_MAX) {
+    // byte_range= : the rows are those whose start nextGoodLine() finds from the range's offsets, as for a jump's first line, so
+    // that processes reading adjacent ranges of a file between them read each row once. The range ends like the file does after
+    // [4], with \0 in place of the line ending before its last row. Detection above used the whole file.
+    const char *fileStart = (const char *)(mmp_copy ? mmp_copy : mmp);
+    const ptrdiff_t oldBytes = eof - pos;
+    if (args.rangeStart > 0) {
+      const char *start = args.rangeStart <= eof-fileStart ? nextGoodLine(fileStart+args.rangeStart-1, ncol) : eof;
+      if (start > pos) pos = start;
+    }
+    if (args.rangeEnd < eof-fileStart) {
+      const char *end = args.rangeEnd>0 ? nextGoodLine(fileStart+args.rangeEnd-1, ncol) : fileStart;
+      if (end <= pos) {
+        eof = pos;
+      } else if (end < eof) {
+        if (eol_one_r) end -= (end[-1]=='\r');
+        else if (end[-1]=='\n') { end--; while (end>pos && end[-1]=='\r') end--; }
+        eof = end;
+      }
+      *const_cast(eof) = '\0';  // cow page
+    }
+    if (verbose) DTPRINT(_("  byte_range=[%"PRId64",%"PRId64") is rows from offset %td to %td\n"),
+                         args.rangeStart, args.rangeEnd, pos-fileStart, eof-fileStart);
+    if (bytesRead) {
+      // the rows are a fraction of those estimated for the whole file; when the file was small enough to be all sampled,
+      // allocnrow is its number of rows which is enough
+      bytesRead = eof - pos;
+      estnrow = (int64_t)ceil((double)estnrow*bytesRead/oldBytes);
+      allocnrow = (int64_t)ceil((double)allocnrow*bytesRead/oldBytes);
+    }
+  }
+  // chunkBytes is the distance between each jump point; it decides the number of jumps
+  // We may want each chunk to write to its own page of the final column, hence 1000*maxLen
+  // For the 44GB file with 12875 columns, the max line len is 108,497. We may want each chunk to write to its
+  // own page (4k) of the final column, hence 1000 rows of the smallest type (4 byte int) is just
+  // under 4096 to leave space for R's header + malloc's header.
+  size_t chunkBytes = umax((uint64_t)(1000*meanLineLen), 1ULL/*MB*/ *1024*1024);
+  if (ndrop && ndrop<ncol && sep!=' ') {
+    // dropped columns are moved over by skip_fields() at a fraction of the cost per byte of the columns that are read, so a
+    // chunk is read more quickly. Larger chunks (up to 4x) keep the per-chunk costs (finding its first line, the ordered push)
+    // in proportion, while leaving each thread at least 4 chunks to balance the load
+    chunkBytes = umax(chunkBytes, umin(chunkBytes*imin(4, ncol/(ncol-ndrop)), (uint64_t)bytesRead/(4*nth)));
+  }
+  if (args.batchRows>0) {
+    // smaller chunks in batch mode so that a team of nth threads reads about batchRows rows per batch
+    chunkBytes = umin(chunkBytes, umax((uint64_t)(args.batchRows*meanLineLen/nth), 64*1024));
+  }
+  // Index of the first jump to read. May be modified if we ever need to restart
+  // reading from the middle of the file.
+  int jump0 = 0;
+  // If we need to restart reading the file because we ran out of allocation
+  // space, then this variable will tell how many new rows has to be allocated.
+  int64_t extraAllocRows = 0;
+
+  if (cacheHit) {
+    chunkBytes = bytesRead / nJumps;
+  } else if (nJumps/*from sampling*/>2) {
+    // ensure data size is split into same sized chunks (no remainder in last chunk) and a multiple of nth
+    // when nth==1 we still split by chunk for consistency (testing) and code sanity
+    nJumps = (int)(bytesRead/chunkBytes);
+    if (nJumps==0) nJumps=1;
+    else if (nJumps>nth) nJumps = nth*(1+(nJumps-1)/nth);
+    chunkBytes = bytesRead / nJumps;
+  } else {
+    ASSERT(nJumps==1 /*when nrowLimit supplied*/ || nJumps==2 /*small files*/, "nJumps (%d) != 1|2", nJumps);
+    nJumps=1;
+  }
+  // The team reads jumps [jump0,batchEnd). That's all of them in one go, except in batch mode where each batch of batchJumps
+  // jumps is handed over by pushBatch() before the next is read into a new datatable
+  int batchJumps = nJumps;
+  if (args.batchRows>0) {
+    batchJumps = imin(nJumps, imax(1, (int)(args.batchRows*meanLineLen/chunkBytes + 0.5)));
+    allocnrow = (int64_t)ceil((double)allocnrow*batchJumps/nJumps);
+  }
+  int batchJump0 = 0, batchEnd = batchJumps;
+  int64_t nrowDelivered = 0;        // batch mode: rows in the batches already handed over
+  jumpRec = malloc(sizeof(*jumpRec) * nJumps);
+  if (!jumpRec)
+    STOP(_("Failed to allocate %zu bytes for '%s'."), sizeof(*jumpRec) * nJumps, "jumpRec"); // # nocov
+
+  // Exact row count, instead of the estimate from the sample which may allocate up to twice the rows or (rarely) too few.
+  // Each chunk's line endings are counted in parallel for both of the quote states it may start in; going through the
+  // chunks in order then fixes the state of each, which gives the row count and each jump's first line (jumpRec[].start)
+  // so that nextGoodLine() is not needed in [11]. It relies on a quote toggling in and out of a quoted field, so it is
+  // not done for quote rules 1 and 2 where a quote may be escaped or appear unquoted inside a field.
+  bool exactStarts = false;
+  int64_t maxJumpRows = 0;
+  if (cacheHit) {
+    for (int jump=0; jump<nJumps; jump++) jumpRec[jump].start = jump==0 ? pos : sof + cacheJump[jump];
+    maxJumpRows = cacheHd.maxJumpRows;
+    exactStarts = true;
+    if (verbose) DTPRINT(_("  %d chunk starts from the cache\n"), nJumps);
+  } else if (bytesRead && nrowLimit==INT64_MAX && args.exactNrow!=false) {
+    size_t rowBytes = 0;
+    for (int j=0; j<ncol; j++) rowBytes += size[j];
+    const bool wanted = args.exactNrow==true || (double)allocnrow*rowBytes >= 2.0*1024*1024*1024;
+    if (wanted && quote && quoteRule!=0 && quoteRule!=3) {
+      if (verbose) DTPRINT(_("  Rows are not counted exactly with quote rule %d\n"), quoteRule);
+    } else if (wanted) {
+      double tCount = wallclock();
+      chunkLines *cl = malloc(sizeof(*cl) * nJumps);
+      if (!cl)
+        STOP(_("Failed to allocate %zu bytes for '%s'."), sizeof(*cl) * nJumps, "chunkLines"); // # nocov
+      const char q = quoteRule==3 ? '\0' : quote, e = eol_one_r ? '\r' : '\n';
+      #pragma omp parallel for num_threads(imin(nth, nJumps))
+      for (int jump=0; jump<nJumps; jump++)
+        countChunkLines(pos+jump*chunkBytes, jump<nJumps-1 ? pos+(jump+1)*chunkBytes : eof, q, e, cl+jump);
+      // a jump starts after the first line ending of its chunk, or where the next one starts when its chunk has none.
+      // A batch's rows are those ending in its chunks plus at most one ending in the chunk after it
+      int64_t nrow = 0, batchNrow = 0, maxBatchNrow = 0;
+      bool in = false;
+      for (int jump=0; jump<nJumps; jump++) {
+        const int64_t n = in ? cl[jump].n - cl[jump].nOut : cl[jump].nOut;
+        const char *first = cl[jump].first[in];
+        jumpRec[jump].start = jump==0 ? pos : (first ? first+1 : NULL);
+        nrow += n;
+        batchNrow += n;
+        if (n > maxJumpRows) maxJumpRows = n;
+        if ((jump+1)%batchJumps==0 || jump==nJumps-1) {
+          if (batchNrow > maxBatchNrow) maxBatchNrow = batchNrow;
+          batchNrow = 0;
+        }
+        in ^= cl[jump].odd;
+      }
+      for (int jump=nJumps-1; jump>0; jump--) if (!jumpRec[jump].start) jumpRec[jump].start = jump<nJumps-1 ? jumpRec[jump+1].start : eof;
+      free(cl);
+      if (eof[-1]!=e) nrow++;  // last line without an ending
+      maxJumpRows++;
+      if (verbose) DTPRINT(_("  Counted %"PRId64" rows exactly (estimate %"PRId64", allocation %"PRId64") in %.3fs\n"),
+                           nrow, estnrow, allocnrow, wallclock()-tCount);
+      estnrow = nrow;
+      allocnrow = batchJumps<nJumps ? maxBatchNrow+1 : nrow;
+      exactStarts = true;
+    }
+  }
+  // thread buffers hold every row of a chunk but the datatable only those kept by filter=, so it starts smaller and is grown by
+  // the usual reallocation in [11] if more rows than that are kept
+  int64_t initialBuffRows = exactStarts ? maxJumpRows : allocnrow / batchJumps;
+  if (args.nfilter) {
+    if (allocnrow/8 > 1024) allocnrow /= 8;
+    else if (allocnrow > 1024) allocnrow = 1024;
+  }
+
   if (verbose) {
     DTPRINT(_("[10] Allocate memory for the datatable\n"));
     DTPRINT(_("  Allocating %d column slots (%d - %d dropped) with %"PRId64" rows\n"),
             ncol-ndrop, ncol, ndrop, allocnrow);
+    if (args.batchRows>0)
+      DTPRINT(_("  Batch mode: %d chunks of %.3fMB per batch, %d batches\n"), batchJumps, (double)chunkBytes/(1024*1024), (nJumps+batchJumps-1)/batchJumps);
   }
   size_t DTbytes = allocateDT(type, size, ncol, ndrop, allocnrow);
+  colOff = malloc(sizeof(*colOff) * ncol);
+  if (!colOff)
+    STOP(_("Failed to allocate %zu bytes for '%s'."), sizeof(*colOff) * ncol, "colOff"); // # nocov
+  if (ndrop && sep!=' ' && !jsonl && !fwf) {
+    // the last column is left to skip_field() so that the end of each line is dealt with as usual
+    dropRun = malloc(sizeof(*dropRun) * ncol);
+    if (!dropRun)
+      STOP(_("Failed to allocate %zu bytes for '%s'."), sizeof(*dropRun) * ncol, "dropRun"); // # nocov
+    dropRun[ncol-1] = 0;
+    for (int j=ncol-2, run=0; j>=0; j--) dropRun[j] = run = (type[j]==CT_DROP ? run+1 : 0);
+  }
   double tAlloc = wallclock();
 
   //*********************************************************************************************
@@ -2261,35 +4482,13 @@ int freadMain(freadMainArgs _args) {
   char internalErr[internalErrSize+1]="";  // must be compile time size: the message is generated and we can't free before STOP
   int64_t DTi = 0;                  // the current row number in DT that we are writing to
   const char *headPos = pos;       // the jump start corresponding to DTi
+  const char *batchStart = pos;    // headPos at the start of this batch (the whole input unless batch mode), where a reread starts from
   int nSwept = 0;                  // count the number of dirty jumps that were swept
   const char *quoteRuleBumpedCh = NULL;   // in the very rare event of an out-of-sample quote rule bump, give a good warning message
   int64_t quoteRuleBumpedLine = -1;
   int buffGrown=0;
-  // chunkBytes is the distance between each jump point; it decides the number of jumps
-  // We may want each chunk to write to its own page of the final column, hence 1000*maxLen
-  // For the 44GB file with 12875 columns, the max line len is 108,497. We may want each chunk to write to its
-  // own page (4k) of the final column, hence 1000 rows of the smallest type (4 byte int) is just
-  // under 4096 to leave space for R's header + malloc's header.
-  size_t chunkBytes = umax((uint64_t)(1000*meanLineLen), 1ULL/*MB*/ *1024*1024);
-  // Index of the first jump to read. May be modified if we ever need to restart
-  // reading from the middle of the file.
-  int jump0 = 0;
-  // If we need to restart reading the file because we ran out of allocation
-  // space, then this variable will tell how many new rows has to be allocated.
-  int64_t extraAllocRows = 0;
-
-  if (nJumps/*from sampling*/>2) {
-    // ensure data size is split into same sized chunks (no remainder in last chunk) and a multiple of nth
-    // when nth==1 we still split by chunk for consistency (testing) and code sanity
-    nJumps = (int)(bytesRead/chunkBytes);
-    if (nJumps==0) nJumps=1;
-    else if (nJumps>nth) nJumps = nth*(1+(nJumps-1)/nth);
-    chunkBytes = bytesRead / nJumps;
-  } else {
-    ASSERT(nJumps==1 /*when nrowLimit supplied*/ || nJumps==2 /*small files*/, "nJumps (%d) != 1|2", nJumps);
-    nJumps=1;
-  }
-  int64_t initialBuffRows = allocnrow / nJumps;
+  int64_t nrowFiltered = 0, nrowFiltered0 = 0;  // rows read but not kept by filter=; in the batches handed over for nrowFiltered0
+  memcpy(tmpType, type, ncol);      // reuse tmpType: in batch mode, the types to start the next batch with
 
   // Catch initialBuffRows==0 when max_nrows is small, seg fault #2243
   // Rather than 10, maybe 1 would work too but then 1.5 grow factor * 1 would still be 1. This clamp
@@ -2304,6 +4503,9 @@ int freadMain(freadMainArgs _args) {
     restartTeam = false;
     if (verbose)
       DTPRINT("  jumps=[%d..%d), chunk_size=%zu, total_size=%td\n", jump0, nJumps, chunkBytes, eof-pos); // # notranslate
+    setColOffsets(ncol);
+    if (args.nfilter) checkFilterTypes(ncol, colNamesAnchor);
+    if (firstTime) for (int jump=jump0; jump<batchEnd; jump++) jumpRec[jump].end = NULL;
     ASSERT(allocnrow <= nrowLimit, "allocnrow(%"PRId64") <= nrowLimit(%"PRId64")", allocnrow, nrowLimit);
     #pragma omp parallel num_threads(nth)
     {
@@ -2318,13 +4520,17 @@ int freadMain(freadMainArgs _args) {
           stopTeam = true;
           // # nocov end
         }
-        myShowProgress = args.showProgress;
+        myShowProgress = args.showProgress && (firstTime || args.batchRows==0);  // in batch mode a reread goes back over this batch only
       }
       int64_t myNrow = 0; // the number of rows in my chunk
+      int myJump = 0;     // the jump my chunk is from
+      int64_t myNfiltered = 0;  // the number of rows in my chunk that filter= did not keep
       int64_t myBuffRows = initialBuffRows;  // Upon realloc, myBuffRows will increase to grown capacity
       bool myStopEarly = false;      // true when an empty or too-short line is encountered when fill=false, or too-long row
+      char keyBuf[JSON_KEYBUF], *keyHeap = NULL;  // jsonl: keys with escapes decoded, see json_decode_key()
+      int8_t *myFilterType = args.nfilter ? malloc(args.nfilter) : NULL;  // see filterBuffer()
     
-      // Allocate thread-private row-major `myBuff`s
+      // Allocate thread-private column-major `myBuff`s
       ThreadLocalFreadParsingContext ctx = {
         .anchor = NULL,
         .buff8 = malloc(rowSize8 * myBuffRows + 8),
@@ -2334,6 +4540,7 @@ int freadMain(freadMainArgs _args) {
         .rowSize8 = rowSize8,
         .rowSize4 = rowSize4,
         .rowSize1 = rowSize1,
+        .buffRows = myBuffRows,
         .DTi = 0,  // which row in the final DT result I should start writing my chunk to
         .nRows = allocnrow,
         .threadn = me,
@@ -2344,13 +4551,13 @@ int freadMain(freadMainArgs _args) {
         .nNonStringCols = nNonStringCols
         #endif
       };
-      if ((rowSize8 && !ctx.buff8) || (rowSize4 && !ctx.buff4) || (rowSize1 && !ctx.buff1)) {
+      if ((rowSize8 && !ctx.buff8) || (rowSize4 && !ctx.buff4) || (rowSize1 && !ctx.buff1) || (args.nfilter && !myFilterType)) {
         stopTeam = true;
       }
       prepareThreadContext(&ctx);
     
       #pragma omp for ordered schedule(dynamic) reduction(+:thRead,thPush) reduction(max:max_col)
-      for (int jump = jump0; jump < nJumps; jump++) {
+      for (int jump = jump0; jump < batchEnd; jump++) {
         if (stopTeam) continue;  // must continue and not break. We desire not to depend on (relatively new) omp cancel directive, yet
         double tLast = 0.0;      // thread local wallclock time at last measuring point for verbose mode only.
         if (verbose) tLast = wallclock();
@@ -2363,10 +4570,14 @@ int freadMain(freadMainArgs _args) {
           // Push buffer now to impl so that :
           //   i) lenoff.off can be "just" 32bit int from a local anchor rather than a 64bit offset from a global anchor
           //  ii) impl can do it in parallel if it wishes, and it can have an orphan critical directive if it wishes
-          // iii) myBuff is hot, so this is the best time to transpose it to result, and first time possible as soon
+          // iii) myBuff is hot, so this is the best time to copy it to result, and first time possible as soon
           //      as we know the previous jump's number of rows.
           //  iv) so that myBuff can be small
           pushBuffer(&ctx);
+          if (firstTime) {
+            #pragma omp flush
+            jumpRec[myJump].nbump = nTypeBump;
+          }
           myNrow = 0;
           if (verbose || myShowProgress) {
             double now = wallclock();
@@ -2382,37 +4593,150 @@ int freadMain(freadMainArgs _args) {
           }
         }
     
-        const char *tch = jump==jump0 ? headPos : nextGoodLine(pos+jump*chunkBytes, ncol);
+        // a reread goes over the lines the first pass found for each jump, moving over the jumps whose rows need no rereading
+        const char *tch = jump==jump0 ? headPos : (!firstTime || exactStarts ? jumpRec[jump].start : nextGoodLine(pos+jump*chunkBytes, ncol));
         const char *thisJumpStart = tch;   // "this" for prev/this/next adjective used later, rather than a (mere) t prefix for thread-local.
         const char *tLineStart = tch;
-        const char *nextJumpStart = jump<nJumps-1 ? nextGoodLine(pos+(jump+1)*chunkBytes, ncol) : eof;
+        const char *nextJumpStart = !firstTime ? jumpRec[jump].end :
+                                    (jump==nJumps-1 ? eof : (exactStarts ? jumpRec[jump+1].start : nextGoodLine(pos+(jump+1)*chunkBytes, ncol)));
+        int64_t myNskipped = 0;
+        if (!firstTime && !jumpRec[jump].reread) {
+          myNskipped = jumpRec[jump].nrow;
+          tch = nextJumpStart;
+        }
+        myJump = jump;
+        if (readAhead && firstTime && jump+nth < nJumps) willNeed(pos + (size_t)(jump+nth)*chunkBytes, chunkBytes);  // the chunk a thread will take next
     
-        void *targets[9] = {NULL, ctx.buff1, NULL, NULL, ctx.buff4, NULL, NULL, NULL, ctx.buff8};
+        // each field's parser is pointed at its column's block by setTarget(); buffs[0] is where the other parsers write
+        int64_t scratch[2];
+        void *buffs[9] = {scratch, ctx.buff1, NULL, NULL, ctx.buff4, NULL, NULL, NULL, ctx.buff8};
+        void *targets[9] = {NULL};
         FieldParseContext fctx = {
           .ch = &tch,
           .targets = targets,
           .anchor = thisJumpStart,
         };
+        const char *vch;  // jsonl and widths=: the parsers see one value at a time, tch stays at the line
+        char fwfBuff[FWF_BUFF];
+        FieldParseContext jctx = {
+          .ch = &vch,
+          .targets = targets,
+          .anchor = thisJumpStart,
+        };
     
-        while (tch<nextJumpStart && (nth>1 || DTi+myNrow<nrowLimit)) {  // setting nrowLimit sets nth to 1 to avoid bump or error on row after nrowLimit
+        while (tch<nextJumpStart && (nth>1 || DTi+nrowFiltered+myNrow<nrowLimit)) {  // setting nrowLimit sets nth to 1 to avoid bump or error on row after nrowLimit
           if (myNrow == myBuffRows) {
             // buffer full due to unusually short lines in this chunk vs the sample; e.g. #2070
+            const int64_t oldBuffRows = myBuffRows;
             myBuffRows *= 1.5;
             #pragma omp atomic
             buffGrown++;
-            ctx.buff8 = realloc(ctx.buff8, rowSize8 * myBuffRows + 8);
-            ctx.buff4 = realloc(ctx.buff4, rowSize4 * myBuffRows + 4);
-            ctx.buff1 = realloc(ctx.buff1, rowSize1 * myBuffRows + 1);
-            if ((rowSize8 && !ctx.buff8) || (rowSize4 && !ctx.buff4) || (rowSize1 && !ctx.buff1)) {
+            ctx.buff8 = growColumnBuffer(ctx.buff8, rowSize8, 8, myNrow, oldBuffRows, myBuffRows);
+            ctx.buff4 = growColumnBuffer(ctx.buff4, rowSize4, 4, myNrow, oldBuffRows, myBuffRows);
+            ctx.buff1 = growColumnBuffer(ctx.buff1, rowSize1, 1, myNrow, oldBuffRows, myBuffRows);
+            if (!ctx.buff8 || !ctx.buff4 || !ctx.buff1) {
               stopTeam = true;
               break;
             }
-            // shift current buffer positions, since `myBuffX`s were probably moved by realloc
-            fctx.targets[8] = OFFSET_POINTER(ctx.buff8, myNrow * rowSize8);
-            fctx.targets[4] = OFFSET_POINTER(ctx.buff4, myNrow * rowSize4);
-            fctx.targets[1] = OFFSET_POINTER(ctx.buff1, myNrow * rowSize1);
+            ctx.buffRows = myBuffRows;
+            // `myBuffX`s were probably moved by realloc; targets are set from buffs for each field
+            buffs[8] = ctx.buff8;
+            buffs[4] = ctx.buff4;
+            buffs[1] = ctx.buff1;
           }
           tLineStart = tch;  // for error message
+          if (jsonl) {
+            tch = json_skip_white(tch);
+            if (tch==eof) break;
+            if (eol(&tch)) { tch++; continue; }
+            if (*tch!='{') { myStopEarly = true; tch = tLineStart; break; }
+            tch++;
+            for (int j=0; j<ncol; j++) {
+              // keys absent from this object are NA
+              const int8_t t = IGNORE_BUMP(type[j]);
+              if (t==CT_DROP) continue;
+              setTarget(targets, buffs, j, t, myNrow, myBuffRows);
+              json_na(&jctx, t);
+            }
+            int col = -1, r;
+            const char *key;
+            int keyLen;
+            bool first = true;
+            while ((r = json_key(&tch, &key, &keyLen, first)) == 1) {
+              first = false;
+              const char *end = json_value_end(tch);
+              if (!end) { r = -1; break; }
+              key = json_decode_key(key, &keyLen, keyBuf, &keyHeap);
+              col = jsonColumn(key, keyLen, col+1, ncol);
+              if (col<0) {
+                // a key sampling did not find: stop, for the input to be read again sampling every line; see [11] below
+                int prev;
+                #pragma omp atomic capture
+                prev = jsonUnknown++;
+                if (prev==0) {
+                  #pragma omp critical
+                  snprintf(jsonUnknownKey, sizeof(jsonUnknownKey), "%.*s", keyLen<100 ? keyLen : 100, key);
+                }
+                stopTeam = true;
+                r = -1;
+                break;
+              } else if (!json_null(tch, end)) {
+                int8_t joldType = type[col];
+                int8_t thisType = joldType;
+                int8_t absType = (int8_t)IGNORE_BUMP(thisType);
+                while (absType < NUMTYPE) {
+                  setTarget(targets, buffs, col, absType, myNrow, myBuffRows);
+                  jctx.col = col;
+                  if (json_value(&jctx, tch, end, absType)) break;
+                  while (++absType<CT_STRING && disabled_parsers[absType]) {};
+                  thisType = TOGGLE_BUMP(absType);
+                }
+                if (thisType != joldType) {
+                  bumpType(col, thisType, tch, (int)(end-tch), nrowDelivered+nrowFiltered+ctx.DTi+myNrow, colNamesAnchor,
+                           &nTypeBump, &nTypeBumpCols, &typeBumpMsg, &typeBumpMsgSize);
+                }
+              }
+              tch = end;
+            }
+            if (r<0) { myStopEarly = true; tch = tLineStart; break; }
+            tch = json_skip_white(tch);
+            if (!eol(&tch) && tch!=eof) { myStopEarly = true; tch = tLineStart; break; }
+            if (tch!=eof) tch++;
+            myNrow++;
+            continue;
+          }
+          if (fwf) {
+            const char *lineEnd = line_end(tch);
+            if (lineEnd==tch && skipEmptyLines) {
+              if (tch==eof) break;
+              eol(&tch);
+              tch++;
+              continue;
+            }
+            for (int j=0; j<ncol; j++) {
+              const char *start = tch+fwfStart[j], *end = start+fwfWidth[j];
+              if (end>lineEnd) end = lineEnd;
+              if (start>end) start = end;
+              int8_t joldType = type[j];
+              int8_t thisType = joldType;
+              int8_t absType = (int8_t)IGNORE_BUMP(thisType);
+              while (absType < NUMTYPE) {
+                setTarget(targets, buffs, j, absType, myNrow, myBuffRows);
+                jctx.col = j;
+                if (fwf_value(&jctx, start, end, absType, fwfBuff)) break;
+                while (++absType<CT_STRING && disabled_parsers[absType]) {};
+                thisType = TOGGLE_BUMP(absType);
+              }
+              if (thisType != joldType) {
+                bumpType(j, thisType, start, (int)(end-start), nrowDelivered+nrowFiltered+ctx.DTi+myNrow, colNamesAnchor,
+                         &nTypeBump, &nTypeBumpCols, &typeBumpMsg, &typeBumpMsgSize);
+              }
+            }
+            tch = lineEnd;
+            if (tch!=eof) { eol(&tch); tch++; }
+            myNrow++;
+            continue;
+          }
           const char *fieldStart = tch;
           int j = 0;
     
@@ -2423,10 +4747,16 @@ int freadMain(freadMainArgs _args) {
               // DTPRINT(_("Field %d: '%.10s' as type %d  (tch=%p)\n"), j+1, tch, type[j], tch);
               fieldStart = tch;
               int8_t thisType = type[j];  // fetch shared type once. Cannot read half-written byte is one reason type's type is single byte to avoid atomic read here.
+              if (dropRun && dropRun[j]) {
+                // move over a run of dropped columns in one go; sizes are 0 so no target moves
+                j += skip_fields(&tch, dropRun[j]);
+                fieldStart = tch;
+                thisType = type[j];
+              }
+              setTarget(targets, buffs, j, IGNORE_BUMP(thisType), myNrow, myBuffRows);
+              fctx.col = j;
               fun[IGNORE_BUMP(thisType)](&fctx);
               if (*tch!=sep) break;
-              int8_t thisSize = size[j];
-              if (thisSize) ((char **) targets)[thisSize] += thisSize;  // 'if' for when rereading to avoid undefined NULL+0
               tch++;
               j++;
             }
@@ -2439,8 +4769,6 @@ int freadMain(freadMainArgs _args) {
               tch = tLineStart;  // in case white space at the beginning may need to be including in field
             }
             else if (eol(&tch) && j<ncol) {   // j<ncol needed for #2523 (erroneous extra comma after last field)
-              int8_t thisSize = size[j];
-              if (thisSize) ((char **) targets)[thisSize] += thisSize;
               j++;
               if (j > max_col) max_col = j;
               if (j==ncol) { tch++; myNrow++; continue; }  // next line. Back up to while (tch<nextJumpStart). Usually happens, fastest path
@@ -2486,6 +4814,8 @@ int freadMain(freadMainArgs _args) {
                 if (!end_of_field(tch)) tch = afterSpace; // else it is the field_end, we're on closing sep|eol and we'll let processor write appropriate NA as if field was empty
                 if (*tch==quote && quote) { quoted=true; tch++; }
               } // else Field() handles NA inside it unlike other processors e.g. ,, is interpreted as "" or NA depending on option read inside Field()
+              setTarget(targets, buffs, j, IGNORE_BUMP(thisType), myNrow, myBuffRows);
+              fctx.col = j;
               fun[IGNORE_BUMP(thisType)](&fctx);
     
               bool typeBump = false;
@@ -2525,33 +4855,9 @@ int freadMain(freadMainArgs _args) {
               if (thisType <= TOGGLE_BUMP(NUMTYPE)) {
                 break;  // Improperly quoted char field needs to be healed below, other columns will be filled #5041 and #4774
               }
-              #pragma omp critical
-              {
-                joldType = type[j];  // fetch shared value again in case another thread bumped it while I was waiting.
-                // Can't print because we're likely not master. So accumulate message and print afterwards.
-                if (thisType < joldType) {   // thisType<0 (type-exception)
-                  if (verbose) {
-                    char temp[1001];
-                    int len = snprintf(temp, 1000,
-                      _("Column %d%s%.*s%s bumped from '%s' to '%s' due to <<%.*s>> on row %"PRId64"\n"),
-                      j+1, colNames?" <<":"", colNames?(colNames[j].len):0, colNames?(colNamesAnchor+colNames[j].off):"", colNames?">>":"",
-                      typeName[IGNORE_BUMP(joldType)], typeName[IGNORE_BUMP(thisType)],
-                      (int)(tch-fieldStart), fieldStart, (int64_t)(ctx.DTi+myNrow));
-                    if (len > 1000) len = 1000;
-                    if (len > 0) {
-                      typeBumpMsg = realloc(typeBumpMsg, typeBumpMsgSize + len + 1);
-                      strcpy(typeBumpMsg+typeBumpMsgSize, temp);
-                      typeBumpMsgSize += len;
-                    }
-                  }
-                  nTypeBump++;
-                  if (joldType>0) nTypeBumpCols++;
-                  type[j] = thisType;
-                } // else another thread just bumped to a (negative) higher or equal type while I was waiting, so do nothing
-              }
+              bumpType(j, thisType, fieldStart, (int)(tch-fieldStart), nrowDelivered+nrowFiltered+ctx.DTi+myNrow, colNamesAnchor,
+                       &nTypeBump, &nTypeBumpCols, &typeBumpMsg, &typeBumpMsgSize);
             }
-            int8_t thisSize = size[j];
-            if (thisSize) ((char**) targets)[size[j]] += size[j];  // 'if' to avoid undefined NULL+=0 when rereading
             j++;
             if (*tch==sep) { tch++; continue; }
             if (fill && (*tch=='\n' || *tch=='\r' || tch==eof) && j<ncol) continue;  // reuse processors to write appropriate NA to target; saves maintenance of a type switch down here
@@ -2569,6 +4875,11 @@ int freadMain(freadMainArgs _args) {
         }
         if (verbose) { double now = wallclock(); thRead += now-tLast; tLast = now; }
         ctx.anchor = thisJumpStart;
+        if (args.nfilter) {
+          const int64_t kept = filterBuffer(&ctx, myNrow, myFilterType);
+          myNfiltered = myNrow - kept;
+          myNrow = kept;
+        }
         ctx.nRows = myNrow;
         postprocessBuffer(&ctx);
     
@@ -2592,7 +4903,7 @@ int freadMain(freadMainArgs _args) {
             if (ctx.DTi + myNrow > allocnrow) {
               // Guess for DT's nrow was insufficient. We cannot realloc DT now because other threads are pushing to DT now in
               // parallel. So, stop team, realloc and then restart reading from this jump.
-              extraAllocRows = (int64_t)((double)(DTi+myNrow)*nJumps/(jump+1) * 1.2) - allocnrow;
+              extraAllocRows = (int64_t)((double)(DTi+myNrow)*(batchEnd-batchJump0)/(jump+1-batchJump0) * 1.2) - allocnrow;
               if (extraAllocRows < 1024) extraAllocRows = 1024;
               myNrow = 0;    // discard my buffer even though it was read correctly; this one jump will be reread wastefully in this rare case
               stopTeam = restartTeam = true;
@@ -2600,7 +4911,14 @@ int freadMain(freadMainArgs _args) {
             } else {
               // tell next thread 2 things :
               headPos = tch;  // i) advance headPos; the jump start up to which all rows have been pushed
-              DTi += myNrow;  // ii) which row in the final result next thread should start writing to since now I know myNrow.
+              DTi += myNrow + myNskipped;  // ii) which row in the final result next thread should start writing to since now I know myNrow.
+              if (firstTime) {
+                jumpRec[jump].start = thisJumpStart;
+                jumpRec[jump].end = tch;
+                jumpRec[jump].nrow = myNrow;
+                jumpRec[jump].nbump = 0;  // set when pushed
+              }
+              nrowFiltered += myNfiltered;
               ctx.nRows = myNrow;
               orderBuffer(&ctx);
               if (myStopEarly) {
@@ -2609,7 +4927,7 @@ int freadMain(freadMainArgs _args) {
                   if (quoteRuleBumpedCh == NULL) {
                     // for warning message if the quote rule bump does in fact manage to heal it, e.g. test 1881
                     quoteRuleBumpedCh = tLineStart;
-                    quoteRuleBumpedLine = row1line+DTi;
+                    quoteRuleBumpedLine = row1line+nrowDelivered+nrowFiltered+DTi;
                   }
                   restartTeam = true;
                   jump0 = jump;  // this jump will restart from headPos, not from its beginning, e.g. test 1453
@@ -2637,18 +4955,34 @@ int freadMain(freadMainArgs _args) {
       if (myNrow) {
         double now = verbose ? wallclock() : 0;
         pushBuffer(&ctx);
+        if (firstTime) {
+          #pragma omp flush
+          jumpRec[myJump].nbump = nTypeBump;
+        }
         if (verbose) thPush += wallclock() - now;
       }
       // Each thread to free their own buffer.
       free(ctx.buff8); ctx.buff8 = NULL;
       free(ctx.buff4); ctx.buff4 = NULL;
       free(ctx.buff1); ctx.buff1 = NULL;
+      free(keyHeap);
+      free(myFilterType);
       freeThreadContext(&ctx);
     }
     //-- end parallel ------------------
     
+    if (jsonUnknown) {
+      // Its column cannot be added now: the columns were allocated for the keys sampled. Unless batches have been handed
+      // over already, tell the caller to read the input again with fill=INT_MAX, which samples every line for its keys.
+      if (args.batchRows || args.fill==INT_MAX)
+        STOP(_("jsonl=TRUE met the key \"%s\" which the sample of lines did not find. Use fill=Inf to sample every line for its keys."), jsonUnknownKey);
+      if (verbose) DTPRINT(_("  Met the key \"%s\" which the sample of lines did not find: stopped to read again sampling every line\n"), jsonUnknownKey);
+      free(typeBumpMsg);
+      freadCleanup();
+      return 2;
+    }
     // cleanup since fill argument for number of columns was too high
-    if (fill>1 && max_col<ncol && max_col>0) {
+    if (fill>1 && max_col<ncol && max_col>0 && args.batchRows==0) {  // not in batch mode where earlier batches have been handed over with all ncol
       int ndropFill = ncol - max_col;
       if (verbose) {
         DTPRINT(_("  Provided number of fill columns: %d but only found %d\n"), ncol, max_col);
@@ -2668,6 +5002,7 @@ int freadMain(freadMainArgs _args) {
       dropFilledCols(dropFill, ndropFill);
     }
     
+    bool lastBatch = batchEnd>=nJumps;
     if (stopTeam) {
       if (internalErr[0]!='\0') {
         STOP(_("Internal error in %s: %s. Please report to the data.table issues tracker"), __func__, internalErr); // # nocov
@@ -2685,15 +5020,17 @@ int freadMain(freadMainArgs _args) {
       }
       if (restartTeam && nrowLimit>0) { // no restarting needed for nrows=0 since we discard read data anyway
         if (verbose) DTPRINT(_("  Restarting team from jump %d. nSwept==%d quoteRule==%d\n"), jump0, nSwept, quoteRule);
+        if (quoteRuleBumpedCh) exactStarts = false;  // the jump starts were found with the quote rule before the bump
         ASSERT(nSwept>0 || quoteRuleBumpedCh!=NULL, "team restart but nSwept==%d and quoteRuleBumpedCh==%p", nSwept, quoteRuleBumpedCh); // # nocov
         continue;
       }
       // else nrowLimit applied and stopped early normally
+      lastBatch = true;
     }
     
     // tell progress meter to finish up; e.g. write final newline
     // if there's a reread, the progress meter will start again from 0
-    if (args.showProgress) progress(100, 0);
+    if (args.showProgress && lastBatch) progress(100, 0);
     
     if (firstTime) {
       tReread = tRead = wallclock();
@@ -2702,17 +5039,39 @@ int freadMain(freadMainArgs _args) {
       // parse types now (for log). We can't count final column types afterwards because many parse types map to the same column type.
       for (int i=0; i<NUMTYPE; i++) typeCounts[i] = 0;
       for (int i=0; i<ncol; i++) typeCounts[ IGNORE_BUMP(type[i]) ]++;
+      if (cacheType) for (int j=0; j<ncol; j++) {
+        if (type[j]<0 && IGNORE_BUMP(type[j])>cacheType[j]) { cacheType[j] = IGNORE_BUMP(type[j]); cacheStale = true; }
+      }
     
       if (nTypeBump) {
         if (verbose) DTPRINT(_("  %d out-of-sample type bumps: %s\n"), nTypeBump, typesAsString(ncol));
+        // The rows pushed before the first bump were pushed as the types they were read as. When every bump is lossless, only
+        // the jumps pushed after it are reread; with filter= the rows kept are not known so every jump is reread.
+        bool rereadAll = args.nfilter>0;
+        for (int j=0; j<ncol; ++j) if (type[j]<0 && !losslessBump(tmpType[j], IGNORE_BUMP(type[j]))) rereadAll = true;
+        int nReread = 0;
+        const char *prevEnd = batchStart;
+        for (int jump=batchJump0; jump<batchEnd; jump++) {
+          jumpRecord *r = jumpRec + jump;
+          if (!r->end) {  // not reached as stopped early; nothing to reread
+            r->start = r->end = prevEnd;
+            r->nrow = 0;
+          }
+          prevEnd = r->end;
+          r->reread = rereadAll || (r->nrow && r->nbump);
+          nReread += r->reread;
+        }
+        if (verbose) DTPRINT(_("  Rereading %d of %d chunks for the bumped columns\n"), nReread, batchEnd-batchJump0);
+        for (int j=0; j<ncol; ++j) tmpType[j] = IGNORE_BUMP(type[j]);  // bumped columns keep their higher type in later batches
         rowSize1 = rowSize4 = rowSize8 = 0;
         nStringCols = 0;
         nNonStringCols = 0;
         for (int j=0; j<ncol; ++j) {
           if (type[j] == CT_DROP) continue;
-          if (type[j]<0) {
-            // column was bumped due to out-of-sample type exception
-            type[j] = TOGGLE_BUMP(type[j]);
+          if (type[j]<0 || args.nfilter) {
+            // column was bumped due to out-of-sample type exception; with filter= every column is reread so that the rows kept
+            // are the same in all of them
+            type[j] = IGNORE_BUMP(type[j]);
             size[j] = typeSize[type[j]];
             rowSize1 += (size[j] & 1);
             rowSize4 += (size[j] & 4);
@@ -2725,11 +5084,13 @@ int freadMain(freadMainArgs _args) {
             size[j] = 0;
           }
         }
-        allocateDT(type, size, ncol, ncol - nStringCols - nNonStringCols, DTi);
-        // reread from the beginning
+        // with filter= the rows kept in the chunks where a filter column was bumped are not known yet, so keep the allocation
+        allocateDT(type, size, ncol, ncol - nStringCols - nNonStringCols, args.nfilter ? allocnrow : DTi);
+        // reread from the beginning (of this batch)
         DTi = 0;
-        headPos = pos;
-        jump0 = 0;
+        nrowFiltered = nrowFiltered0;
+        headPos = batchStart;
+        jump0 = batchJump0;
         firstTime = false;
         nSwept = 0;
         continue;
@@ -2738,11 +5099,48 @@ int freadMain(freadMainArgs _args) {
       tReread = wallclock();
     }
 
+    if (args.batchRows>0) {
+      if (verbose) DTPRINT(_("  Batch of %"PRId64" rows from chunks [%d..%d) handed over\n"), DTi, batchJump0, batchEnd);
+      pushBatch(DTi);
+      if (!lastBatch) {
+        nrowDelivered += DTi;
+        DTi = 0;
+        nrowFiltered0 = nrowFiltered;
+        batchStart = headPos;  // where the last row of this batch ended
+        jump0 = batchJump0 = batchEnd;
+        batchEnd = imin(batchEnd + batchJumps, nJumps);
+        memcpy(type, tmpType, ncol);  // undo the reread's skipping of the columns that weren't bumped
+        rowSize1 = rowSize4 = rowSize8 = 0;
+        nStringCols = 0;
+        nNonStringCols = 0;
+        for (int j=0; j<ncol; ++j) {
+          if (type[j] == CT_DROP) continue;
+          size[j] = typeSize[type[j]];
+          rowSize1 += (size[j] & 1);
+          rowSize4 += (size[j] & 4);
+          rowSize8 += (size[j] & 8);
+          if (type[j] == CT_STRING) nStringCols++; else nNonStringCols++;
+        }
+        firstTime = true;
+        nTypeBump = 0;
+        allocateDT(type, size, ncol, ncol - nStringCols - nNonStringCols, allocnrow);
+        continue;
+      }
+    }
     break;
   }
   double tTot = tReread-t0;  // tReread==tRead when there was no reread
   if (verbose) DTPRINT(_("Read %"PRIu64" rows x %d columns from %s file in %02d:%06.3f wall clock time\n"),
-       (uint64_t)DTi, ncol-ndrop, filesize_to_str(fileSize), (int)tTot/60, fmod(tTot,60.0));
+       (uint64_t)(nrowDelivered+DTi), ncol-ndrop, filesize_to_str(fileSize), (int)tTot/60, fmod(tTot,60.0));
+  if (verbose && args.nfilter) DTPRINT(_("  filter= kept %"PRIu64" of %"PRIu64" rows read\n"), (uint64_t)(nrowDelivered+DTi), (uint64_t)(nrowDelivered+nrowFiltered+DTi));
+  if (cacheType && (cacheStale || quoteRule!=cacheHd.quoteRule) && args.batchRows==0 && !args.nfilter && bytesRead>0 && DTi>0 && headPos==eof) {
+    // the whole file was read in one go so every jump's start and row count is known
+    cacheHd.quoteRule = quoteRule;
+    cacheHd.nrow = DTi;
+    cacheHd.maxJumpRows = 0;
+    for (int jump=0; jump<nJumps; jump++) if (jumpRec[jump].nrow > cacheHd.maxJumpRows) cacheHd.maxJumpRows = jumpRec[jump].nrow;
+    saveCache(nJumps);
+  }
 
   //*********************************************************************************************
   // [12] Finalize the datatable
@@ -2754,9 +5152,32 @@ int freadMain(freadMainArgs _args) {
       DTPRINT(_("%10d : %-9s '%c'\n"), typeCounts[i], typeName[i], typeLetter[i]);
     }
   }
-  setFinalNrow(DTi);
+  if (args.batchRows==0) setFinalNrow(DTi);  // else the last batch was handed over by pushBatch()
+
+  if (args.nfile>1 && args.batchRows==0 && !args.nfilter && !skipEmptyLines && (!quote || quoteRule==0 || quoteRule==3)) {
+    // The rows from each file are its line endings outside quotes from the first row on, counted as for the exact row count.
+    // Rows are read in order, so when fewer were read (nrows= or stopped early) they are those of the first files.
+    int64_t *fileNrow = fileOff + (args.nfile+1);  // readFiles() has finished with the rest of fileOff
+    const char q = quoteRule==3 ? '\0' : quote, e = eol_one_r ? '\r' : '\n';
+    #pragma omp parallel for num_threads(nth) schedule(dynamic)
+    for (int k=0; k<args.nfile; k++) {
+      const char *from = (const char *)mmp_copy + fileOff[k], *to = (const char *)mmp_copy + fileOff[k+1];
+      if (from<pos) from = pos;
+      if (to>eof) to = eof;
+      chunkLines cl = {0};
+      if (from<to) countChunkLines(from, to, q, e, &cl);
+      fileNrow[k] = cl.nOut + (from<to && to==eof);  // the last line's ending was replaced by the final \0
+    }
+    int64_t left = DTi;
+    for (int k=0; k<args.nfile; k++) {
+      fileNrow[k] = imin(fileNrow[k], left);
+      left -= fileNrow[k];
+    }
+    if (left==0) setFileNrows(fileNrow, args.nfile);
+    else if (verbose) DTPRINT(_("  The rows from each file are not known: %"PRId64" more rows were read than lines were found\n"), left);
+  }
 
-  if (headPos<eof && DTi<nrowLimit) {
+  if (headPos<eof && DTi+nrowFiltered<nrowLimit) {
     ch = headPos;
     while (ch<eof && isspace(*ch)) ch++;
     if (ch==eof) {
@@ -2769,15 +5190,19 @@ int freadMain(freadMainArgs _args) {
       if (ch==eof) {
         DTWARN(_("Discarded single-line footer: <<%s>>"), strlim(skippedFooter,500));
       }
+      else if (jsonl) {
+        DTWARN(_("Stopped early on line %"PRId64", which is not a JSON object on one line: <<%s>>"),
+        nrowDelivered+nrowFiltered+DTi+row1line, strlim(skippedFooter,500));
+      }
       else {
         ch = headPos;
         int tt = countfields(&ch);
         if (fill>0) {
           DTWARN(_("Stopped early on line %"PRId64". Expected %d fields but found %d. Consider fill=%d or even more based on your knowledge of the input file. Use fill=Inf for reading the whole file for detecting the number of fields. First discarded non-empty line: <<%s>>"),
-          DTi+row1line, ncol, tt, tt, strlim(skippedFooter,500));
+          nrowDelivered+nrowFiltered+DTi+row1line, ncol, tt, tt, strlim(skippedFooter,500));
         } else {
           DTWARN(_("Stopped early on line %"PRId64". Expected %d fields but found %d. Consider fill=TRUE. First discarded non-empty line: <<%s>>"),
-          DTi+row1line, ncol, tt, strlim(skippedFooter,500));
+          nrowDelivered+nrowFiltered+DTi+row1line, ncol, tt, strlim(skippedFooter,500));
         }
       }
     }
@@ -2800,9 +5225,9 @@ int freadMain(freadMainArgs _args) {
     thRead/=nth; thPush/=nth;
     double thWaiting = tReread-tAlloc-thRead-thPush;
     DTPRINT(_("%8.3fs (%3.0f%%) Reading %d chunks (%d swept) of %.3fMB (each chunk %"PRId64" rows) using% d threads\n"),
-            tReread-tAlloc, 100.0*(tReread-tAlloc)/tTot, nJumps, nSwept, (double)chunkBytes/(1024*1024), DTi/nJumps, nth);
-    DTPRINT(_("   + %8.3fs (%3.0f%%) Parse to row-major thread buffers (grown %d times)\n"), thRead, 100.0*thRead/tTot, buffGrown);
-    DTPRINT(_("   + %8.3fs (%3.0f%%) Transpose\n"), thPush, 100.0*thPush/tTot);
+            tReread-tAlloc, 100.0*(tReread-tAlloc)/tTot, nJumps, nSwept, (double)chunkBytes/(1024*1024), (nrowDelivered+DTi)/nJumps, nth);
+    DTPRINT(_("   + %8.3fs (%3.0f%%) Parse to column-major thread buffers (grown %d times)\n"), thRead, 100.0*thRead/tTot, buffGrown);
+    DTPRINT(_("   + %8.3fs (%3.0f%%) Push to result columns\n"), thPush, 100.0*thPush/tTot);
     DTPRINT(_("   + %8.3fs (%3.0f%%) Waiting\n"), thWaiting, 100.0*thWaiting/tTot);
     DTPRINT(_("%8.3fs (%3.0f%%) Rereading %d columns due to out-of-sample type exceptions\n"),
             tReread-tRead, 100.0*(tReread-tRead)/tTot, nTypeBumpCols);
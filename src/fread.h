@@ -25,7 +25,7 @@
 //   which uses only 4 bytes.
 typedef enum {
   NEG = -1,        // dummy to force signed type; sign bit used for out-of-sample type bump management
-  CT_DROP = 0,     // skip column requested by user; it is navigated as a string column with the prevailing quoteRule
+  CT_DROP = 0,     // skip column requested by user; moved over without parsing, quoted fields as a string column with the prevailing quoteRule
   CT_EMPTY,        // int8_t; first enum value must be 1 not 0(=CT_DROP) so that it can be negated to -1. EMPTY to help column heading guess, #5257
   CT_BOOL8_N,      // int8_t
   CT_BOOL8_U,
@@ -39,6 +39,7 @@ typedef enum {
   CT_FLOAT64_HEX,  // double, in hexadecimal format
   CT_ISO8601_DATE, // integer, as read from a date in ISO-8601 format
   CT_ISO8601_TIME, // double, as read from a timestamp in ISO-8601 time
+  CT_TIME_FORMAT,  // double, as read from a timestamp in the user's format for the column; never detected, only set by userOverride()
   CT_STRING,       // lenOff struct below
   NUMTYPE          // placeholder for the number of types including drop; used for allocation and loop bounds
 } colType;
@@ -68,6 +69,41 @@ typedef struct {
 #define NA_LENOFF        INT32_MIN  // lenOff.len only; lenOff.off undefined for NA
 
 
+// A row filter: column `col` compared with constants. Rows for which any
+// filter is false are dropped by each thread before they are pushed.
+typedef enum {
+  FILTER_EQ = 0,
+  FILTER_NE,
+  FILTER_LT,
+  FILTER_LE,
+  FILTER_GT,
+  FILTER_GE,
+  FILTER_IN
+} filterOp;
+
+typedef struct {
+  int col;               // 0-based column number; set by userOverride() at the latest
+  filterOp op;
+  int n;                 // number of constants; 1 unless op is FILTER_IN
+  const double *num;     // numeric constants (dates as days and times as seconds since epoch), or NULL
+  const int64_t *i64;    // integer64 constants, compared exactly with a column read as integer64; num has them as double. Or NULL
+  const char **str;      // the constants as strings (an NA is NULL) for a string column, or NULL. Given for numbers
+  const int *strLen;     //   too when op is FILTER_EQ, FILTER_NE or FILTER_IN in case the column is read as string
+  bool naIn;             // the constants include NA: no row matches unless op is FILTER_IN
+} freadFilter;
+
+// How a file is brought into memory. The default maps it and lets the pages
+// be faulted in as the threads reach them; the others suit cold caches and
+// very large files, depending on the file system.
+typedef enum {
+  INPUT_MMAP = 0,    // mmap() and page faults
+  INPUT_SEQUENTIAL,  // mmap() advised as read sequentially; each thread asks for its next chunk to be read ahead
+  INPUT_POPULATE,    // mmap() with every page read in straight away (MAP_POPULATE, else MADV_WILLNEED)
+  INPUT_HUGEPAGE,    // as INPUT_SEQUENTIAL and also advised to be backed by transparent huge pages
+  INPUT_READ         // read() into memory by all threads in parallel, in large blocks; no mmap()
+} inputMode;
+
+
 
 // *****************************************************************************
 
@@ -78,16 +114,62 @@ typedef struct freadMainArgs
   // will not validate the encoding).
   const char *filename;
 
+  // With `nfile` > 1, the files to read as one of which `filename` is the
+  // first. They are read whole into one buffer, without the first line of
+  // each file after the first when it repeats the first file's (the column
+  // names; unless `header` is false), so that the separator, column names
+  // and types are detected once for all of them and all their rows are read
+  // in parallel into one datatable. The rows from each file are then given
+  // to `setFileNrows()`.
+  const char * const* filenames;
+  int nfile;
+
   // Data buffer: a \0-terminated C string. When this parameter is given,
   // fread() will read from the provided string. This parameter is exclusive
   // with `filename`.
   const char *input;
 
+  // A command whose standard output is read instead, through a pipe, so that
+  // it does not have to be written to a file first. Exclusive with `filename`
+  // and `input`.
+  const char *cmd;
+
+  // Once more than `cmdMax` bytes of the output of `cmd` have been read, they
+  // and the rest of it are written to the file `cmdSpill` instead, which is
+  // then memory mapped as a file is. NULL to keep all of the output in memory.
+  const char *cmdSpill;
+  size_t cmdMax;
+
   // Maximum number of rows to read, or INT64_MAX to read the entire dataset.
   // Note that even if `nrowLimit = 0`, fread() will scan a sample of rows in
   // the file to detect column names and types (and other parsing settings).
   int64_t nrowLimit;
 
+  // Count the rows exactly before allocating: a parallel pass over the input
+  // for its line endings outside quotes, which also gives each chunk its exact
+  // first line. false never, true always (when the quote rule allows) and
+  // NA_BOOL8 only when the allocation from the sample's estimate would be
+  // large. Not done when `nrowLimit` is given.
+  int8_t exactNrow;
+
+  // If positive, read in batches of about this many rows: each batch is read
+  // into a datatable of its own and handed over by `pushBatch()` before the
+  // next is read, so that memory use is bounded by the batch size rather than
+  // by the size of the input. 0 reads everything into one datatable.
+  int64_t batchRows;
+
+  // Rows are kept only when all `nfilter` filters are true. NA is never
+  // equal to, less or greater than anything, but it is in a FILTER_IN set
+  // which contains NA. `nrowLimit` counts rows before they are filtered.
+  freadFilter *filters;
+  int nfilter;
+
+  // With `nwidths` > 0, each line is fixed width fields rather than
+  // separated ones: a positive width is the next column's number of bytes, a
+  // negative width skips that many. sep, quote and fill are then unused.
+  const int32_t *widths;
+  int nwidths;
+
   // Number of input lines to skip when reading the file.
   int64_t skipNrow;
 
@@ -95,11 +177,29 @@ typedef struct freadMainArgs
   // with `skipLines`.
   const char *skipString;
 
+  // Read only the rows which start at a byte offset of the file in
+  // [rangeStart, rangeEnd); 0 and INT64_MAX to read them all. A row's start
+  // is found from an offset as a jump's first line is, so that ranges which
+  // meet read each row once. The header and column types are still detected
+  // from the start of the file and its sample. Files only, not `input`.
+  int64_t rangeStart, rangeEnd;
+
   // NULL-terminated list of strings that should be converted into NA values.
   // The last entry in this array is NULL (sentinel), which lets us know where
   // the array ends.
   const char * const* NAstrings;
 
+  // Directory of the detection cache, or NULL for none. A complete read of a
+  // file saves there the separator, quote rule, column types (including any
+  // found out-of-sample), row count and chunk starts, which a later read of
+  // the same unchanged file with the same detection arguments uses instead of
+  // sampling the file again.
+  const char *cacheDir;
+
+  // How a file is brought into memory; see inputMode. Input other than a
+  // single file is always read into memory.
+  int8_t inputMode;
+
   // Maximum number of threads. If 0, then fread will use the maximum possible
   // number of threads, as determined by omp_get_max_threads(). If negative,
   // then fread will use that many threads less than allowed maximum (but
@@ -167,7 +267,9 @@ typedef struct freadMainArgs
   // should datetime with no Z or UTZ-offset be read as UTC?
   bool noTZasUTC;
 
-  char _padding[1];
+  // Each line is a JSON object; its keys are the column names and a key
+  // missing from a line is NA there.
+  bool jsonl;
 
   // Any additional implementation-specific parameters.
   FREAD_MAIN_ARGS_EXTRA_FIELDS
@@ -188,8 +290,11 @@ typedef struct ThreadLocalFreadParsingContext
   // example all `lenOff` columns, `double` columns and `int64` columns will be
   // written to buffer `buff8`; at the same time `bool` and `int8` columns will
   // be stored in memory buffer `buff1`.
-  // Within each buffer the data is stored in row-major order, i.e. in the same
-  // order as in the original CSV file.
+  // Within each buffer the data is stored in column-major order: each column
+  // has a contiguous block of `buffRows` values, and the blocks are in the
+  // same order as the columns in the file. A column's block thus starts at
+  // byte `off * buffRows`, where `off` is the total size of the columns of the
+  // same size to its left, i.e. its byte offset within a row.
   void *restrict buff8;
   void *restrict buff4;
   void *restrict buff1;
@@ -200,11 +305,15 @@ typedef struct ThreadLocalFreadParsingContext
   size_t rowSize4;
   size_t rowSize1;
 
+  // Number of rows each column's block within the buffers has room for; the
+  // allocation size of each `buffX` is at least `buffRows * rowSizeX`.
+  size_t buffRows;
+
   // Starting row index within the output DataTable for the current data chunk.
   size_t DTi;
 
-  // Number of rows currently being stored within the buffers. The allocation
-  // size of each `buffX` is thus at least `nRows * rowSizeX`.
+  // Number of rows currently being stored within the buffers; at most
+  // `buffRows`.
   size_t nRows;
 
   // Reference to the flag that controls the parser's execution. Setting this
@@ -231,6 +340,10 @@ typedef struct ThreadLocalFreadParsingContext
  *
  * It should have been called just "fread", but that name is already defined in
  * the system libraries...
+ *
+ * Returns 1, or 2 when `jsonl` is true and the read met a key which the sample
+ * of lines did not find: nothing has been read then, and the caller should
+ * call it again with `fill` INT_MAX so that every line is sampled for its keys.
  */
 int freadMain(freadMainArgs args);
 
@@ -273,6 +386,15 @@ bool userOverride(int8_t *types, lenOff *colNames, const char *anchor,
                   const int ncol);
 
 
+/**
+ * Called after `userOverride()` for each column it set to CT_TIME_FORMAT, to
+ * fetch that column's strptime-style format; e.g. "%d/%m/%Y %H:%M:%OS". The
+ * string must stay valid until `freadMain` returns. freadMain compiles it once
+ * and halts if it uses a directive that is not supported.
+ */
+const char *colTimeFormat(int col);
+
+
 /**
  * This function is invoked by `freadMain` before the main scan of the input
  * file. It should allocate the resulting `DataTable` structure and prepare
@@ -310,6 +432,11 @@ bool userOverride(int8_t *types, lenOff *colNames, const char *anchor,
  *    account for possible variation. It is very unlikely that this number
  *    underestimates the final row count.
  *
+ * When a column's type has changed for a reread, the values already pushed to
+ * it must be kept, converted to the new type, if both are numeric: after a
+ * lossless bump (e.g. int32 to int64 or float64) only the rows that were not
+ * pushed as the type they were read as are reread.
+ *
  * @return
  *    this function should return the total size of the Datatable created (for
  *    reporting purposes). If the return value is 0, then it indicates an error
@@ -346,9 +473,9 @@ void orderBuffer(ThreadLocalFreadParsingContext *ctx);
 /**
  * This function transfers the scanned input data into the final DataTable
  * structure. It will be called many times, and from parallel threads (thus
- * it should not attempt to modify any global variables). Its primary job is
- * to transpose the data: convert from row-major order within each buffer
- * into the column-major order for the resulting DataTable.
+ * it should not attempt to modify any global variables). Since the buffers
+ * are column-major like the resulting DataTable, each column is a contiguous
+ * run of `nRows` values to copy to its rows from `DTi`.
  */
 void pushBuffer(ThreadLocalFreadParsingContext *ctx);
 
@@ -365,6 +492,26 @@ void pushBuffer(ThreadLocalFreadParsingContext *ctx);
 void setFinalNrow(size_t nrows);
 
 
+/**
+ * Batch mode only (`batchRows > 0`): called from the master thread between
+ * teams once the first `nrows` rows of the datatable from the latest
+ * `allocateDT()` hold a complete batch, including any rereads. The
+ * implementation finalizes and hands over that datatable; the next call to
+ * `allocateDT()` must start a new one. Called for every batch including the
+ * last, in which case `setFinalNrow()` is not called.
+ */
+void pushBatch(size_t nrows);
+
+
+/**
+ * Multiple files only (`nfile > 1`): called at the end with the number of
+ * rows of the datatable which came from each file, in order. Not called when
+ * that cannot be told from the line endings in each file: in batch mode,
+ * with filters or skipEmptyLines, or when quotes may be escaped.
+ */
+void setFileNrows(const int64_t *nrows, int nfile);
+
+
 /**
  * Called at the end to delete columns added due to too high user guess for fill.
  */
@@ -384,5 +531,15 @@ void progress(int percent/*[0,100]*/, int ETA/*secs*/);
 
 bool freadCleanup(void);
 double wallclock(void);
+double gzipInflatedSize(const char *fnam);
+double availableRAM(void);
+
+/**
+ * Decode the escapes of a JSON string (the `len` bytes between its quotes) to
+ * UTF-8 in `dest`, which needs room for `len` bytes as decoding never makes it
+ * longer. \u0000 and malformed \u escapes are kept as they are. Returns the
+ * decoded length.
+ */
+int jsonDecode(const char *src, int len, char *dest);
 
 #endif
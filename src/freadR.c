@@ -25,9 +25,9 @@ Secondary separator for list() columns, such as columns 11 and 12 in BED (no nee
 #define NUT  NUMTYPE+2  // +1 for "numeric" alias for "double"; +1 for CLASS fallback using as.class() at R level afterwards
 
 // these correspond to typeName, typeSize in fread.c, with few exceptions notes above on the NUT macro.
-static int  typeSxp[NUT] =     {NILSXP,  LGLSXP,    LGLSXP,     LGLSXP,     LGLSXP,     LGLSXP,     LGLSXP,     INTSXP,    REALSXP,     REALSXP,    REALSXP,        REALSXP,        INTSXP,          REALSXP,         STRSXP,      REALSXP,    STRSXP   };
-static char typeRName[NUT][10]={"NULL",  "logical", "logical",  "logical",  "logical",  "logical",  "logical",  "integer", "integer64", "double",   "double",       "double",       "IDate",         "POSIXct",       "character", "numeric",  "CLASS"  };
-static int  typeEnum[NUT] =    {CT_DROP, CT_EMPTY,  CT_BOOL8_N, CT_BOOL8_U, CT_BOOL8_T, CT_BOOL8_L, CT_BOOL8_Y, CT_INT32,  CT_INT64,    CT_FLOAT64, CT_FLOAT64_HEX, CT_FLOAT64_EXT, CT_ISO8601_DATE, CT_ISO8601_TIME, CT_STRING,   CT_FLOAT64, CT_STRING};
+static int  typeSxp[NUT] =     {NILSXP,  LGLSXP,    LGLSXP,     LGLSXP,     LGLSXP,     LGLSXP,     LGLSXP,     INTSXP,    REALSXP,     REALSXP,    REALSXP,        REALSXP,        INTSXP,          REALSXP,         REALSXP,        STRSXP,      REALSXP,    STRSXP   };
+static char typeRName[NUT][10]={"NULL",  "logical", "logical",  "logical",  "logical",  "logical",  "logical",  "integer", "integer64", "double",   "double",       "double",       "IDate",         "POSIXct",       "POSIXct",      "character", "numeric",  "CLASS"  };
+static int  typeEnum[NUT] =    {CT_DROP, CT_EMPTY,  CT_BOOL8_N, CT_BOOL8_U, CT_BOOL8_T, CT_BOOL8_L, CT_BOOL8_Y, CT_INT32,  CT_INT64,    CT_FLOAT64, CT_FLOAT64_HEX, CT_FLOAT64_EXT, CT_ISO8601_DATE, CT_ISO8601_TIME, CT_TIME_FORMAT, CT_STRING,   CT_FLOAT64, CT_STRING};
 static colType readInt64As=CT_INT64;
 static SEXP selectSxp;
 static SEXP dropSxp;
@@ -44,9 +44,28 @@ static int8_t *size;
 static int ncol = 0;
 static int64_t dtnrows = 0;
 static bool verbose = false;
+static double tStrCritical = 0, tStrWait = 0;  // verbose only: time inside and waiting for pushBuffer's critical, summed over threads
+static int64_t nStrCells = 0, nStrMkChar = 0;  // verbose only: non-empty string cells pushed, and mkCharLenCE calls made for them
 static bool warningsAreErrors = false;
 static bool oldNoDateTime = false;
+static bool noTZisUTC = false;  // tz="UTC": a time without an offset is UTC, rather than local
 static int *dropFill;
+static double stringsAsFactors = 0;  // 0 when FALSE, R_PosInf when TRUE, otherwise the fraction of nrow that a column's number of distinct values must be below
+static const char **timeFormat;  // per input column: the colClasses= format of a CT_TIME_FORMAT column; see colTimeFormat()
+static int8_t *asFactor;  // per input column: 1 if colClasses="factor", 2 if a stringsAsFactors candidate; read as factor directly when its type is CT_STRING
+static SEXP factorLevels; // per input column: levels in order of first appearance, with spare capacity
+static SEXP factorTables; // per input column: open addressing hash table (twice the capacity of its levels) of 1-based level, 0 for empty
+static int *factorNlevel; // per input column: number of levels used so far
+static SEXP selectOrder;  // selectRank converted to the order to pass to setcolorder()
+static SEXP batchFun;     // batch mode: called with each batch's data.table; its results are collected in batchAns
+static SEXP batchAns;
+static int nBatch = 0;
+static bool inBatch = false;  // true while batchFun runs: fread's state is static so fread cannot be called from there
+static SEXP filterSxp;    // filter= parsed at R level: list of list(col=, op=, value=, str=)
+static freadFilter *filters;
+static bool jsonl = false;
+static char *jsonBuff = NULL;  // jsonl: a string value with escapes is decoded here, inside pushBuffer's critical
+static size_t jsonBuffSize = 0;
 
 SEXP freadR(
   // params passed to freadMain
@@ -58,6 +77,7 @@ SEXP freadR(
   SEXP headerArg,
   SEXP nrowLimitArg,
   SEXP skipArg,
+  SEXP byteRangeArg,
   SEXP NAstringsArg,
   SEXP stripWhiteArg,
   SEXP skipEmptyLinesArg,
@@ -68,6 +88,8 @@ SEXP freadR(
   SEXP warnings2errorsArg,
   SEXP logical01Arg,
   SEXP logicalYNArg,
+  SEXP jsonlArg,
+  SEXP widthsArg,
 
   // extras needed by callbacks from freadMain
   SEXP selectArg,
@@ -76,27 +98,74 @@ SEXP freadR(
   SEXP integer64Arg,
   SEXP encodingArg,
   SEXP keepLeadingZerosArgs,
-  SEXP noTZasUTC
+  SEXP noTZasUTC,
+  SEXP stringsAsFactorsArg,
+  SEXP filterArg,
+  SEXP batchRowsArg,
+  SEXP batchFunArg
 ) {
+  if (inBatch) error(_("fread() cannot be called from FUN while fread_chunked() is reading a file"));
   verbose = LOGICAL(verboseArg)[0];
+  stringsAsFactors = isLogical(stringsAsFactorsArg) ? (LOGICAL(stringsAsFactorsArg)[0]==TRUE ? R_PosInf : 0) : REAL(stringsAsFactorsArg)[0];
+  asFactor = NULL;
+  factorNlevel = NULL;
+  tStrCritical = tStrWait = 0;
+  nStrCells = nStrMkChar = 0;
   warningsAreErrors = LOGICAL(warnings2errorsArg)[0];
 
   freadMainArgs args;
   ncol = 0;
   dtnrows = 0;
 
-  if (!isString(inputArg) || LENGTH(inputArg)!=1)
-    internal_error(__func__, "freadR input not a single character string: a filename or the data itself. Should have been caught at R level.");  // # nocov
+  if (!isLogical(isFileNameArg) || LENGTH(isFileNameArg)!=1)
+    internal_error(__func__, "freadR isFileNameArg not TRUE, FALSE or NA");  // # nocov
+  const int isFileName = LOGICAL(isFileNameArg)[0];  // NA when the input is a command to read the output of
+  const int ninput = isString(inputArg) ? LENGTH(inputArg) : 0;
+  if (ninput<1 || (ninput>2 && isFileName==NA_LOGICAL))
+    internal_error(__func__, "freadR input not a filename, command or the data itself, or several filenames or lines. Should have been caught at R level.");  // # nocov
   const char *ch = (const char *)CHAR(STRING_ELT(inputArg,0));
-  if (!isLogical(isFileNameArg) || LENGTH(isFileNameArg)!=1 || LOGICAL(isFileNameArg)[0]==NA_LOGICAL)
-    internal_error(__func__, "freadR isFileNameArg not TRUE or FALSE");  // # nocov
-  if (LOGICAL(isFileNameArg)[0]) {
+  args.filename = NULL;
+  args.filenames = NULL;
+  args.nfile = isFileName==TRUE ? ninput : 1;
+  args.input = NULL;
+  args.cmd = args.cmdSpill = NULL;
+  args.cmdMax = SIZE_MAX;
+  if (isFileName==NA_LOGICAL) {
+    if (verbose) DTPRINT(_("freadR.c has been passed a command to read the output of: %s\n"), ch);
+    args.cmd = ch;
+    if (ninput==2) {
+      // the file to write the output to once it is more than options(datatable.fread.cmd.max=) bytes, by default half the available memory
+      args.cmdSpill = CHAR(STRING_ELT(inputArg,1));
+      SEXP tt = GetOption1(sym_fread_cmd_max);
+      const double max = isNumeric(tt) && LENGTH(tt)==1 ? asReal(tt) : availableRAM()/2;
+      args.cmdMax = ISNAN(max) || max<0 ? SIZE_MAX : max>=(double)SIZE_MAX ? SIZE_MAX : (size_t)max;
+    }
+  } else if (isFileName && ninput>1) {
+    if (verbose) DTPRINT(_("freadR.c has been passed %d filenames to read as one, the first is: %s\n"), ninput, ch);
+    const char **filenames = (const char **)R_alloc(ninput, sizeof(*filenames));
+    for (int k=0; k<ninput; k++) filenames[k] = CHAR(STRING_ELT(inputArg,k));  // path.expand()-ed at R level
+    args.filenames = filenames;
+    args.filename = filenames[0];
+  } else if (isFileName) {
     if (verbose) DTPRINT(_("freadR.c has been passed a filename: %s\n"), ch);
     args.filename = R_ExpandFileName(ch);  // for convenience so user doesn't have to call path.expand()
-    args.input = NULL;
+  } else if (ninput>1) {
+    if (verbose) DTPRINT(_("freadR.c has been passed the data as %d lines of text input (not a filename)\n"), ninput);
+    // joined here, each followed by \n, rather than written to a temporary file at R level
+    size_t len = 0;
+    for (int i=0; i<ninput; i++) len += LENGTH(STRING_ELT(inputArg,i)) + 1;
+    char *buf = R_alloc(len + 1, 1);
+    size_t off = 0;
+    for (int i=0; i<ninput; i++) {
+      const SEXP line = STRING_ELT(inputArg,i);
+      memcpy(buf+off, CHAR(line), LENGTH(line));
+      off += LENGTH(line);
+      buf[off++] = '\n';
+    }
+    buf[len] = '\0';
+    args.input = buf;
   } else {
     if (verbose) DTPRINT(_("freadR.c has been passed the data as text input (not a filename)\n"));
-    args.filename = NULL;
     args.input = ch;
   }
 
@@ -124,18 +193,47 @@ SEXP freadR(
   else if (LOGICAL(headerArg)[0]==TRUE) args.header = true;
 
   args.nrowLimit = INT64_MAX;
-  if (!isReal(nrowLimitArg) || length(nrowLimitArg)!=1)
-    internal_error(__func__, "nrows not a single real. R level catches this.");  // # nocov
-  if (R_FINITE(REAL(nrowLimitArg)[0]) && REAL(nrowLimitArg)[0]>=0.0)
-    args.nrowLimit = (int64_t)(REAL(nrowLimitArg)[0]);
+  args.exactNrow = NA_BOOL8;  // count exactly when the estimate would allocate a lot
+  if (isString(nrowLimitArg) && length(nrowLimitArg)==1 && !strcmp(CHAR(STRING_ELT(nrowLimitArg,0)), "exact")) {
+    args.exactNrow = true;
+  } else {
+    if (!isReal(nrowLimitArg) || length(nrowLimitArg)!=1)
+      internal_error(__func__, "nrows not a single real or \"exact\". R level catches this.");  // # nocov
+    if (R_FINITE(REAL(nrowLimitArg)[0]) && REAL(nrowLimitArg)[0]>=0.0)
+      args.nrowLimit = (int64_t)(REAL(nrowLimitArg)[0]);
+  }
 
   args.logical01 = LOGICAL(logical01Arg)[0];
   args.logicalYN = LOGICAL(logicalYNArg)[0];
+  args.jsonl = jsonl = LOGICAL(jsonlArg)[0];
+  if (jsonl && args.cmdSpill) args.cmdMax = 0;  // keep the output of cmd in its file, to read it again should the read meet a key the sample did not
+  args.widths = INTEGER(widthsArg);  // checked at R level
+  args.nwidths = LENGTH(widthsArg);
+  free(jsonBuff);  // in case the previous call stopped with an error
+  jsonBuff = NULL;
+  jsonBuffSize = 0;
   {
     SEXP tt = PROTECT(GetOption1(sym_old_fread_datetime_character));
     args.oldNoDateTime = oldNoDateTime = isLogical(tt) && LENGTH(tt)==1 && LOGICAL(tt)[0]==TRUE;
     UNPROTECT(1);
   }
+  {
+    SEXP tt = GetOption1(sym_fread_cache);  // the options list keeps the string alive for the duration of the call
+    args.cacheDir = isString(tt) && LENGTH(tt)==1 && STRING_ELT(tt,0)!=NA_STRING ? CHAR(STRING_ELT(tt,0)) : NULL;
+  }
+  {
+    SEXP tt = GetOption1(sym_fread_input);
+    static const char *modes[] = {"mmap", "sequential", "populate", "hugepage", "read"};  // in inputMode order
+    args.inputMode = INPUT_MMAP;
+    if (!isNull(tt)) {
+      int m = 0;
+      if (isString(tt) && LENGTH(tt)==1 && STRING_ELT(tt,0)!=NA_STRING)
+        while (m<5 && strcmp(CHAR(STRING_ELT(tt,0)), modes[m])) m++;
+      if (!isString(tt) || LENGTH(tt)!=1 || m==5)
+        STOP(_("options(datatable.fread.input=) must be one of \"mmap\", \"sequential\", \"populate\", \"hugepage\" or \"read\""));
+      args.inputMode = (int8_t)m;
+    }
+  }
   args.skipNrow=-1;
   args.skipString=NULL;
   if (isString(skipArg)) {
@@ -143,6 +241,14 @@ SEXP freadR(
   } else if (isInteger(skipArg)) {
     args.skipNrow = (int64_t)INTEGER(skipArg)[0];
   } else internal_error(__func__, "skip not integer or string"); // # nocov
+  args.rangeStart = 0;
+  args.rangeEnd = INT64_MAX;
+  if (!isNull(byteRangeArg)) {
+    if (!isReal(byteRangeArg) || LENGTH(byteRangeArg)!=2)
+      internal_error(__func__, "byte_range not 2 doubles. R level catches this.");  // # nocov
+    args.rangeStart = (int64_t)REAL(byteRangeArg)[0];
+    if (R_FINITE(REAL(byteRangeArg)[1])) args.rangeEnd = (int64_t)REAL(byteRangeArg)[1];
+  }
 
   if (!isNull(NAstringsArg) && !isString(NAstringsArg))
     internal_error(__func__, "NAstringsArg is type '%s'. R level catches this", type2char(TYPEOF(NAstringsArg)));  // # nocov
@@ -164,7 +270,10 @@ SEXP freadR(
   args.verbose = verbose;
   args.warningsAreErrors = warningsAreErrors;
   args.keepLeadingZeros = LOGICAL(keepLeadingZerosArgs)[0];
-  args.noTZasUTC = LOGICAL(noTZasUTC)[0];
+  args.noTZasUTC = noTZisUTC = LOGICAL(noTZasUTC)[0];
+  args.batchRows = isNull(batchRowsArg) ? 0 : (int64_t)REAL(batchRowsArg)[0];  // checked at R level
+  batchFun = batchFunArg;
+  nBatch = 0;
 
   // === extras used for callbacks ===
   if (!isString(integer64Arg) || LENGTH(integer64Arg)!=1) error(_("'integer64' must be a single character string"));
@@ -214,12 +323,94 @@ SEXP freadR(
   else if (strcmp(tt, "Latin-1")==0) ienc = CE_LATIN1;
   else if (strcmp(tt, "UTF-8")==0) ienc = CE_UTF8;
   else STOP(_("encoding='%s' invalid. Must be 'unknown', 'Latin-1' or 'UTF-8'"), tt);  // # nocov
+
+  // filter= was checked at R level; its column names are matched to the file's by userOverride()
+  filterSxp = filterArg;
+  filters = NULL;
+  args.nfilter = length(filterArg);
+  if (args.nfilter) {
+    static const char *ops[] = {"==", "!=", "<", "<=", ">", ">=", "%in%"};  // in filterOp order
+    filters = (freadFilter *)R_alloc(args.nfilter, sizeof(*filters));
+    for (int f=0; f<args.nfilter; f++) {
+      const SEXP elt = VECTOR_ELT(filterArg, f);
+      SEXP value = VECTOR_ELT(elt, 2);
+      freadFilter *flt = filters + f;
+      const char *op = CHAR(STRING_ELT(VECTOR_ELT(elt, 1), 0));
+      int k = 0;
+      while (k<FILTER_IN && strcmp(op, ops[k])) k++;
+      flt->col = -1;
+      flt->op = (filterOp)k;
+      flt->n = LENGTH(value);
+      flt->num = NULL;
+      flt->i64 = NULL;
+      flt->str = NULL;
+      flt->strLen = NULL;
+      flt->naIn = false;
+      if (isReal(value) && INHERITS(value, char_integer64)) {
+        // its bits, for a column read as integer64; as double for any other numeric column
+        const int64_t *i64 = (const int64_t *)REAL(value);
+        double *num = (double *)R_alloc(flt->n, sizeof(*num));
+        for (int i=0; i<flt->n; i++) {
+          flt->naIn |= i64[i]==NA_INT64;
+          num[i] = i64[i]==NA_INT64 ? NA_REAL : (double)i64[i];
+        }
+        flt->i64 = i64;
+        flt->num = num;
+        value = VECTOR_ELT(elt, 3);
+      } else if (isReal(value)) {
+        flt->num = REAL(value);
+        for (int i=0; i<flt->n; i++) flt->naIn |= ISNAN(flt->num[i]);
+        value = VECTOR_ELT(elt, 3);  // as.character() of the numbers for ==, != and %in%, else NULL
+      }
+      if (isString(value)) {
+        const char **str = (const char **)R_alloc(flt->n, sizeof(*str));
+        int *strLen = (int *)R_alloc(flt->n, sizeof(*strLen));
+        for (int i=0; i<flt->n; i++) {
+          const SEXP s = STRING_ELT(value, i);
+          if (s==NA_STRING) { str[i] = NULL; strLen[i] = 0; flt->naIn = true; continue; }
+          str[i] = ienc==CE_UTF8 ? translateCharUTF8(s) : CHAR(s);
+          strLen[i] = strlen(str[i]);
+        }
+        flt->str = str;
+        flt->strLen = strLen;
+      }
+    }
+  }
+  args.filters = filters;
   // === end extras ===
 
-  RCHK = PROTECT(allocVector(VECSXP, 4));
+  RCHK = PROTECT(allocVector(VECSXP, 8));
   // see kalibera/rchk#9 and Rdatatable/data.table#2865.  To avoid rchk false positives.
   // allocateDT() assigns DT to position 0. userOverride() assigns colNamesSxp to position 1 and colClassesAs to position 2 (both used in allocateDT())
-  freadMain(args);
+  // userOverride() assigns factorLevels to position 4 and factorTables to position 5 when any column may be read as factor
+  // userOverride() assigns selectRank to position 3, allocateDT() assigns selectOrder to position 6 and freadR() assigns batchAns to position 7
+  batchAns = R_NilValue;
+  if (args.batchRows) SET_VECTOR_ELT(RCHK, 7, batchAns=allocVector(VECSXP, 16));
+  if (freadMain(args)==2) {
+    // jsonl: a key beyond the sample of lines; read again sampling every line, so that it is a column too
+    if (verbose) DTPRINT(_("freadR.c is reading the input again with fill=Inf\n"));
+    args.fill = INT_MAX;
+    if (args.cmd) { args.filename = args.cmdSpill; args.cmd = NULL; }  // the output of cmd, written to its file
+    ncol = 0;
+    dtnrows = 0;
+    asFactor = NULL;
+    factorNlevel = NULL;
+    freadMain(args);
+  }
+  free(jsonBuff);
+  jsonBuff = NULL;
+  jsonBuffSize = 0;
+  if (verbose && nStrCells) {
+    const int64_t avoided = nStrCells - nStrMkChar;
+    DTPRINT(_("String columns: %"PRId64" non-empty cells needed %"PRId64" mkCharLenCE calls (%"PRId64" repeats reused an existing CHARSXP, saving an estimated %.3fs of serial time)\n"),
+            nStrCells, nStrMkChar, avoided, nStrMkChar ? tStrCritical/nStrMkChar*avoided : 0.0);
+    DTPRINT(_("   %.3fs inside and %.3fs waiting to enter the single-threaded CHARSXP section, summed over threads\n"), tStrCritical, tStrWait);
+  }
+  if (args.batchRows) {
+    SEXP ans = lengthgets(batchAns, nBatch);  // the results of FUN, one per batch
+    UNPROTECT(1);
+    return ans;
+  }
   UNPROTECT(1);
   return DT;
 }
@@ -251,6 +442,20 @@ static void applyDrop(SEXP items, int8_t *type, int ncol, int dropSource) {
   UNPROTECT(1);
 }
 
+static int8_t timeFormatType(int col, SEXP fmt)
+{
+  // The type to read a column with a strptime-style colClasses= format as. fread.c reads it when the time it gives is
+  // absolute: UTC (tz="UTC"), with its offset (%z) or since the epoch (%s %Q). A local time (tz="") is read as character
+  // for as.POSIXct(format=) at R level, as the ISO 8601 parser leaves unmarked times.
+  const char *f = CHAR(fmt);
+  if (noTZisUTC || strstr(f, "%z") || strstr(f, "%s") || strstr(f, "%Q")) {
+    timeFormat[col] = f;
+    return CT_TIME_FORMAT;
+  }
+  SET_STRING_ELT(colClassesAs, col, fmt);
+  return CT_STRING;
+}
+
 bool userOverride(int8_t *type, lenOff *colNames, const char *anchor, const int ncol)
 {
   // use typeSize superfluously to avoid not-used warning; otherwise could move typeSize from fread.h into fread.c
@@ -281,7 +486,7 @@ bool userOverride(int8_t *type, lenOff *colNames, const char *anchor, const int
     }
     UNPROTECT(1);  // listNames
   }
-  selectRank = NULL;
+  selectRank = selectOrder = NULL;
   const int *selectInts = NULL; // if select is provided this will point to 1-based ints of the column numbers (which might already be the input as-is)
   int nprotect = 0;  // just used for select; other protects are specifically balanced within loops to save the protection stack, whereas select is long-lived or no-alloc.
   if (length(selectSxp)) {
@@ -312,13 +517,18 @@ bool userOverride(int8_t *type, lenOff *colNames, const char *anchor, const int
     }
   }
   colClassesAs = NULL; // any coercions we can't handle here in C are deferred to R (to handle with methods::as) via this attribute
+  timeFormat = NULL;
   if (length(colClassesSxp)) {
+    // a colClasses= type containing % is a strptime-style format; e.g. colClasses=c(when="%d/%m/%Y %H:%M:%OS") reads column
+    // 'when' as POSIXct in fread.c, see timeFormatType(). The format is applied whatever type was detected.
+    timeFormat = (const char **)R_alloc(ncol, sizeof(*timeFormat));
     SEXP typeRName_sxp = PROTECT(allocVector(STRSXP, NUT));
     for (int i=0; i<NUT; i++) SET_STRING_ELT(typeRName_sxp, i, mkChar(typeRName[i]));
     if (oldNoDateTime) {
       // prevent colClasses="IDate"/"POSIXct" being recognized so that colClassesAs is assigned here ready for type massage after reading at R level; test 2150.14
       SET_STRING_ELT(typeRName_sxp, CT_ISO8601_DATE, R_BlankString);
       SET_STRING_ELT(typeRName_sxp, CT_ISO8601_TIME, R_BlankString);
+      SET_STRING_ELT(typeRName_sxp, CT_TIME_FORMAT, R_BlankString);
     }
     SET_VECTOR_ELT(RCHK, 2, colClassesAs=allocVector(STRSXP, ncol));
     if (isString(colClassesSxp)) {
@@ -333,7 +543,9 @@ bool userOverride(int8_t *type, lenOff *colNames, const char *anchor, const int
           const SEXP tt = STRING_ELT(colClassesSxp, i&mask); // mask recycles colClassesSxp when it's length-1
           if (tt==NA_STRING || tt==R_BlankString) continue;  // user is ok with inherent type for this column
           int w = INTEGER(typeEnum_idx)[i&mask];
-          if (tt==char_POSIXct) {
+          if (strchr(CHAR(tt), '%')) {
+            type[i] = timeFormatType(i, tt);
+          } else if (tt==char_POSIXct) {
             // from v1.13.0, POSIXct is a built in type, but if the built-in doesn't support (e.g. test 1743.25 has missing tzone) then we still dispatch to as.POSIXct afterwards
             if (type[i]!=CT_ISO8601_TIME) {
               type[i]=CT_STRING; // e.g. CT_ISO8601_DATE changed to character here so that as.POSIXct treats the date-only as local time in tests 1743.122 and 2150.11
@@ -354,7 +566,9 @@ bool userOverride(int8_t *type, lenOff *colNames, const char *anchor, const int
           int w = INTEGER(typeEnum_idx)[i];
           int y = selectInts[i];
           if (y==NA_INTEGER) continue;
-          if (tt==char_POSIXct) {
+          if (strchr(CHAR(tt), '%')) {
+            type[y-1] = timeFormatType(y-1, tt);
+          } else if (tt==char_POSIXct) {
             if (type[y-1]!=CT_ISO8601_TIME) {
               type[y-1]=CT_STRING;
               SET_STRING_ELT(colClassesAs, y-1, tt);
@@ -381,6 +595,8 @@ bool userOverride(int8_t *type, lenOff *colNames, const char *anchor, const int
       for (int i=0; i<LENGTH(colClassesSxp); i++) {
         const int colClassTypeIdx = INTEGER(typeEnum_idx)[i];
         signed char colClassType = typeEnum[colClassTypeIdx-1];
+        const char *fmt = strchr(CHAR(STRING_ELT(listNames, i)), '%') ? CHAR(STRING_ELT(listNames, i)) : NULL;
+        if (fmt) colClassType = CT_TIME_FORMAT;
         if (colClassType == CT_DROP) continue;  // was dealt with earlier above
         SEXP items = VECTOR_ELT(colClassesSxp,i);
         SEXP itemsInt;
@@ -409,7 +625,9 @@ bool userOverride(int8_t *type, lenOff *colNames, const char *anchor, const int
           }
           if (selectRankD) selectRankD[colIdx-1] = rank++;
           // NB: mark as negative to indicate 'seen'
-          if (type[colIdx-1]==CT_ISO8601_DATE && colClassType==CT_STRING && STRING_ELT(listNames, i) == char_Date) {
+          if (fmt) {
+            type[colIdx-1] = -timeFormatType(colIdx-1, STRING_ELT(listNames, i));
+          } else if (type[colIdx-1]==CT_ISO8601_DATE && colClassType==CT_STRING && STRING_ELT(listNames, i) == char_Date) {
             type[colIdx-1] *= -1;
           } else if (colClassType == CT_ISO8601_TIME && type[colIdx-1]!=CT_ISO8601_TIME) {
             type[colIdx-1] = -CT_STRING; // don't use in-built UTC parser, defer to character and as.POSIXct afterwards which reads in local time
@@ -433,10 +651,56 @@ bool userOverride(int8_t *type, lenOff *colNames, const char *anchor, const int
   if (readInt64As != CT_INT64) {
     for (int i=0; i<ncol; i++) if (type[i]==CT_INT64) type[i] = readInt64As;
   }
+  // colClasses="factor" and stringsAsFactors are done here rather than by as_factor() at R level afterwards: such a column is
+  // allocated as integer codes and pushBuffer looks each distinct value up in the column's dictionary so that only new levels need a CHARSXP
+  bool anyFactor = false;
+  asFactor = (int8_t *)R_alloc(ncol, sizeof(*asFactor));
+  for (int i=0; i<ncol; i++) {
+    const SEXP tt = colClassesAs ? STRING_ELT(colClassesAs, i) : R_BlankString;
+    asFactor[i] = tt==char_factor ? 1 : (tt==R_BlankString && stringsAsFactors>0 ? 2 : 0);
+    anyFactor |= asFactor[i];
+  }
+  if (anyFactor) {
+    SET_VECTOR_ELT(RCHK, 4, factorLevels=allocVector(VECSXP, ncol));
+    SET_VECTOR_ELT(RCHK, 5, factorTables=allocVector(VECSXP, ncol));
+    factorNlevel = (int *)R_alloc(ncol, sizeof(*factorNlevel));
+  } else {
+    asFactor = NULL;
+  }
+  for (int f=0; f<length(filterSxp); f++) {
+    const SEXP name = VECTOR_ELT(VECTOR_ELT(filterSxp, f), 0);
+    const int k = INTEGER(PROTECT(chmatch(name, colNamesSxp, NA_INTEGER)))[0];
+    UNPROTECT(1);
+    if (k==NA_INTEGER)
+      STOP(_("filter= uses column '%s' which is not a column name in the file. Note that names given by col.names= are applied afterwards."), CHAR(STRING_ELT(name, 0)));
+    filters[f].col = k-1;
+  }
   return true;
 }
 
 
+static void widenColumn(SEXP dest, SEXP src, bool srcIsInt64, bool destIsInt64, size_t nrow) {
+  // a column bumped by fread.c to a wider numeric type on the reread keeps the values already pushed; fread.c only rereads the
+  // rows that were not pushed as the type they were read as
+  if (TYPEOF(src)==REALSXP) {
+    if (!srcIsInt64 || destIsInt64) return;  // double to double is not a change of type
+    const int64_t *s = (const int64_t *)REAL(src);
+    double *d = REAL(dest);
+    for (size_t i=0; i<nrow; i++) d[i] = s[i]==NA_INT64 ? NA_REAL : (double)s[i];
+    return;
+  }
+  const int *s = INTEGER(src);  // LGLSXP or INTSXP
+  if (TYPEOF(dest)==INTSXP) {
+    memcpy(INTEGER(dest), s, nrow*sizeof(int));
+  } else if (destIsInt64) {
+    int64_t *d = (int64_t *)REAL(dest);
+    for (size_t i=0; i<nrow; i++) d[i] = s[i]==NA_INTEGER ? NA_INT64 : s[i];
+  } else {
+    double *d = REAL(dest);
+    for (size_t i=0; i<nrow; i++) d[i] = s[i]==NA_INTEGER ? NA_REAL : s[i];
+  }
+}
+
 size_t allocateDT(int8_t *typeArg, int8_t *sizeArg, int ncolArg, int ndrop, size_t allocNrow) {
   // save inputs for use by pushBuffer
   size = sizeArg;
@@ -447,7 +711,7 @@ size_t allocateDT(int8_t *typeArg, int8_t *sizeArg, int ncolArg, int ndrop, size
     dtnrows = allocNrow;
     SET_VECTOR_ELT(RCHK, 0, DT=allocVector(VECSXP, ncol-ndrop));
     if (ndrop==0) {
-      setAttrib(DT, R_NamesSymbol, colNamesSxp);  // colNames mkChar'd in userOverride step
+      setAttrib(DT, R_NamesSymbol, batchFun==R_NilValue ? colNamesSxp : duplicate(colNamesSxp));  // colNames mkChar'd in userOverride step; each batch gets its own
       if (colClassesAs) setAttrib(DT, sym_colClassesAs, colClassesAs);
     } else {
       int nprotect = 0;
@@ -466,17 +730,17 @@ size_t allocateDT(int8_t *typeArg, int8_t *sizeArg, int ncolArg, int ndrop, size
       SEXP tt = PROTECT(allocVector(INTSXP, ncol-ndrop));
       int *ttD = INTEGER(tt), *rankD = INTEGER(selectRank), rank=1;
       for (int i=0; i<ncol; ++i) if (type[i]!=CT_DROP) ttD[ rankD[i]-1 ] = rank++;
-      SET_VECTOR_ELT(RCHK, 3, selectRank = tt);
-      // selectRank now holds the order not the rank (so its name is now misleading). setFinalNRow passes it to setcolorder
+      SET_VECTOR_ELT(RCHK, 6, selectOrder = tt);
+      // setFinalNRow passes selectOrder to setcolorder; selectRank is kept as it is for the next batch's data.table in batch mode
       // we can't change column order now because they might be reallocated in the reread
       UNPROTECT(1); // tt
     }
-    colClassesAs = getAttrib(DT, sym_colClassesAs);
+    SEXP resColClassesAs = getAttrib(DT, sym_colClassesAs);
     bool none = true;
-    const int n = length(colClassesAs);
-    for (int i=0; i<n; ++i) if (STRING_ELT(colClassesAs,i) != R_BlankString) { none=false; break; }
+    const int n = length(resColClassesAs);
+    for (int i=0; i<n; ++i) if (STRING_ELT(resColClassesAs,i) != R_BlankString) { none=false; break; }
     if (none) setAttrib(DT, sym_colClassesAs, R_NilValue);
-    else if (selectRank) setAttrib(DT, sym_colClassesAs, subsetVector(colClassesAs, selectRank));  // reorder the colClassesAs
+    else if (selectOrder) setAttrib(DT, sym_colClassesAs, subsetVector(resColClassesAs, selectOrder));  // reorder the colClassesAs
   }
   // TODO: move DT size calculation into a separate function (since the final size is different from the initial size anyways)
   size_t DTbytes = SIZEOF(DT)*(ncol-ndrop)*2; // the VECSXP and its column names (exclude global character cache usage)
@@ -494,13 +758,25 @@ size_t allocateDT(int8_t *typeArg, int8_t *sizeArg, int ncolArg, int ndrop, size
     SEXP col = VECTOR_ELT(DT, resi);
     int oldIsInt64 = newDT? 0 : INHERITS(col, char_integer64);
     int newIsInt64 = type[i] == CT_INT64;
-    int typeChanged = (type[i] > 0) && (newDT || TYPEOF(col) != typeSxp[type[i]] || oldIsInt64 != newIsInt64);
+    int oldIsFactor = newDT? 0 : INHERITS(col, char_factor);
+    int newIsFactor = type[i] == CT_STRING && asFactor && asFactor[i];
+    int typeChanged = (type[i] > 0) && (newDT || TYPEOF(col) != (newIsFactor ? INTSXP : typeSxp[type[i]]) || oldIsInt64 != newIsInt64 || oldIsFactor != newIsFactor);
     int nrowChanged = (allocNrow != dtnrows);
     if (typeChanged || nrowChanged) {
-      SEXP thiscol = typeChanged ? allocVector(typeSxp[type[i]], allocNrow)  // no need to PROTECT, passed immediately to SET_VECTOR_ELT, see R-exts 5.9.1
+      SEXP thiscol = typeChanged ? allocVector(newIsFactor ? INTSXP : typeSxp[type[i]], allocNrow)  // no need to PROTECT, passed immediately to SET_VECTOR_ELT, see R-exts 5.9.1
                                  : growVector(col, allocNrow);
+      if (typeChanged && !newDT && !oldIsFactor && !newIsFactor && isVectorAtomic(col) && TYPEOF(col)!=STRSXP && TYPEOF(thiscol)!=STRSXP)
+        widenColumn(thiscol, col, oldIsInt64, newIsInt64, allocNrow<dtnrows ? allocNrow : dtnrows);
       SET_VECTOR_ELT(DT,resi,thiscol);
-      if (type[i]==CT_INT64) {
+      if (typeChanged && newIsFactor) {
+        // levels are set by setFinalNrow once they are all known; a fresh dictionary for a column bumped to character and reread
+        setAttrib(thiscol, R_ClassSymbol, ScalarString(char_factor));
+        SET_VECTOR_ELT(factorLevels, i, allocVector(STRSXP, 1024));
+        SEXP table = allocVector(INTSXP, 2048);
+        SET_VECTOR_ELT(factorTables, i, table);
+        memset(INTEGER(table), 0, 2048*sizeof(int));
+        factorNlevel[i] = 0;
+      } else if (type[i]==CT_INT64) {
         SEXP tt = PROTECT(ScalarString(char_integer64));
         setAttrib(thiscol, R_ClassSymbol, tt);
         UNPROTECT(1);
@@ -510,7 +786,7 @@ size_t allocateDT(int8_t *typeArg, int8_t *sizeArg, int ncolArg, int ndrop, size
         SET_STRING_ELT(tt, 1, char_Date);
         setAttrib(thiscol, R_ClassSymbol, tt);
         UNPROTECT(1);
-      } else if (type[i] == CT_ISO8601_TIME) {
+      } else if (type[i] == CT_ISO8601_TIME || type[i] == CT_TIME_FORMAT) {
         SEXP tt = PROTECT(allocVector(STRSXP, 2));
         SET_STRING_ELT(tt, 0, char_POSIXct);
         SET_STRING_ELT(tt, 1, char_POSIXt);
@@ -529,8 +805,57 @@ size_t allocateDT(int8_t *typeArg, int8_t *sizeArg, int ncolArg, int ndrop, size
 }
 
 
+static void setFactorLevels(size_t nrow) {
+  // the levels of each column read as factor are in order of first appearance which depends on thread scheduling; sort them as
+  // as_factor() does at R level and renumber the codes. For stringsAsFactors=<fraction> the column is returned to character when
+  // it has too many distinct values, like uniqueN(v) < nrow*stringsAsFactors did at R level. Before setcolorder so resi is still file order.
+  int nFactor = 0;
+  int64_t nLevel = 0;
+  for (int i=0, resi=-1; i<ncol; i++) {
+    if (type[i]==CT_DROP) continue;
+    resi++;
+    SEXP col = VECTOR_ELT(DT, resi);
+    if (!asFactor[i] || !INHERITS(col, char_factor)) continue;
+    const int nlevel = factorNlevel[i];
+    int *codes = INTEGER(col);
+    SEXP levels = PROTECT(allocVector(STRSXP, nlevel));
+    for (int k=0; k<nlevel; k++) SET_STRING_ELT(levels, k, STRING_ELT(VECTOR_ELT(factorLevels, i), k));
+    SET_VECTOR_ELT(factorLevels, i, R_NilValue);
+    SET_VECTOR_ELT(factorTables, i, R_NilValue);
+    if (asFactor[i]==2 && R_FINITE(stringsAsFactors)) {
+      bool anyNA = false;
+      for (size_t r=0; r<nrow; r++) if (codes[r]==NA_INTEGER) { anyNA=true; break; }
+      if (!(nlevel + anyNA < nrow*stringsAsFactors)) {
+        SEXP chr = PROTECT(allocVector(STRSXP, dtnrows));  // dtnrows not nrow since the loop in setFinalNrow sets its length and truelength as the other columns
+        for (size_t r=0; r<nrow; r++) SET_STRING_ELT(chr, r, codes[r]==NA_INTEGER ? NA_STRING : STRING_ELT(levels, codes[r]-1));
+        SET_TRUELENGTH(chr, dtnrows);
+        SET_VECTOR_ELT(DT, resi, chr);
+        UNPROTECT(2); // levels, chr
+        continue;
+      }
+    }
+    SEXP f = PROTECT(ScalarLogical(FALSE)), t = PROTECT(ScalarLogical(TRUE)), one = PROTECT(ScalarInteger(1));
+    SEXP o = PROTECT(forder(levels, R_NilValue, /*retGrp=*/f, /*retStats=*/f, /*sort=*/t, /*order=*/one, /*na.last=*/f));
+    if (LENGTH(o)) {  // integer() when already sorted
+      const int *od = INTEGER(o);
+      int *newCode = (int *)R_alloc(nlevel, sizeof(*newCode));
+      for (int k=0; k<nlevel; k++) newCode[od[k]-1] = k+1;
+      for (size_t r=0; r<nrow; r++) if (codes[r]!=NA_INTEGER) codes[r] = newCode[codes[r]-1];
+      setAttrib(col, R_LevelsSymbol, subsetVector(levels, o));
+    } else {
+      setAttrib(col, R_LevelsSymbol, levels);
+    }
+    UNPROTECT(5); // levels, f, t, one, o
+    nFactor++;
+    nLevel += nlevel;
+  }
+  if (verbose && nFactor)
+    DTPRINT(Pl_(nFactor, "%d column was read directly as factor, with %"PRId64" levels\n", "%d columns were read directly as factor, with %"PRId64" levels in total\n"), nFactor, nLevel);
+}
+
 void setFinalNrow(size_t nrow) {
-  if (selectRank) setcolorder(DT, selectRank);  // selectRank was changed to contain order (not rank) in allocateDT above
+  if (asFactor) setFactorLevels(nrow);
+  if (selectOrder) setcolorder(DT, selectOrder);
   if (length(DT)) {
     if (nrow == dtnrows)
       return;
@@ -544,6 +869,30 @@ void setFinalNrow(size_t nrow) {
   R_FlushConsole(); // # 2481. Just a convenient place; nothing per se to do with setFinalNrow()
 }
 
+void pushBatch(size_t nrow) {
+  setFinalNrow(nrow);
+  if (nBatch == LENGTH(batchAns)) {
+    SEXP tt = growVector(batchAns, 2*nBatch);
+    SET_VECTOR_ELT(RCHK, 7, batchAns=tt);
+  }
+  SEXP call = PROTECT(lang2(batchFun, DT));
+  int err = 0;
+  inBatch = true;
+  SEXP ans = R_tryEvalSilent(call, R_GlobalEnv, &err);  // not eval() so that an error in FUN unwinds through halt__() and freadCleanup() below
+  inBatch = false;
+  if (err) STOP(_("FUN failed on batch %d so fread_chunked() has stopped reading. %s"), nBatch+1, R_curErrorBuf());
+  SET_VECTOR_ELT(batchAns, nBatch++, ans);
+  UNPROTECT(1);  // call
+  ncol = 0;  // allocateDT() will start a new data.table for the next batch; this one now belongs to FUN
+}
+
+void setFileNrows(const int64_t *nrows, int nfile) {
+  SEXP ans = PROTECT(allocVector(REALSXP, nfile));  // fread() at R level uses it for idcol= and then removes it
+  for (int k=0; k<nfile; k++) REAL(ans)[k] = (double)nrows[k];
+  setAttrib(DT, sym_fileNrows, ans);
+  UNPROTECT(1);
+}
+
 void dropFilledCols(int* dropArg, int ndelete) {
   dropFill = dropArg;
   int ndt=length(DT);
@@ -555,6 +904,65 @@ void dropFilledCols(int* dropArg, int ndelete) {
   SETLENGTH(colNamesSxp, ndt-ndelete);
 }
 
+static inline uint64_t strHash(const char *str, int len) {
+  uint64_t h = 14695981039346656037ULL;  // FNV-1a
+  for (int k=0; k<len; k++) h = (h ^ (uint8_t)str[k]) * 1099511628211ULL;
+  return h;
+}
+
+// jsonl: fread.c passes a JSON string value as is, without its quotes. One with a backslash is decoded to UTF-8 in jsonBuff.
+// This runs inside the critical so one buffer suffices; the input is not decoded in place because a reread sees it again.
+static void jsonUnescape(const char **str, int *len)
+{
+  if ((*str)[-1]!='"' || !memchr(*str, '\\', *len)) return;  // a number or nested object/array in a string column, or no escapes
+  if (jsonBuffSize < (size_t)*len) {
+    char *tt = realloc(jsonBuff, *len);
+    if (!tt) return;  // # nocov; leave the value as it is in the file
+    jsonBuff = tt;
+    jsonBuffSize = *len;
+  }
+  *len = jsonDecode(*str, *len, jsonBuff);
+  *str = jsonBuff;
+}
+
+static int factorCode(int j, const char *str, int len, int64_t *nMkChar)
+{
+  // Called from pushBuffer's critical only. Returns the 1-based level of str in input column j, adding it as a new level when not seen before
+  SEXP levels = VECTOR_ELT(factorLevels, j);
+  int *table = INTEGER(VECTOR_ELT(factorTables, j));
+  size_t mask = LENGTH(VECTOR_ELT(factorTables, j)) - 1;
+  const uint64_t h = strHash(str, len);
+  size_t slot = h & mask;
+  for (int code; (code=table[slot]); slot=(slot+1)&mask) {
+    SEXP lev = STRING_ELT(levels, code-1);
+    if (LENGTH(lev)==len && memcmp(CHAR(lev), str, len)==0) return code;
+  }
+  const int nlevel = factorNlevel[j];
+  if (nlevel == LENGTH(levels)) {
+    // double the capacity of the levels and their table, then rehash
+    SEXP newLevels = allocVector(STRSXP, 2*(R_xlen_t)nlevel);
+    for (int k=0; k<nlevel; k++) SET_STRING_ELT(newLevels, k, STRING_ELT(levels, k));
+    SET_VECTOR_ELT(factorLevels, j, levels=newLevels);
+    SEXP newTable = allocVector(INTSXP, 4*(R_xlen_t)nlevel);
+    SET_VECTOR_ELT(factorTables, j, newTable);
+    table = INTEGER(newTable);
+    memset(table, 0, 4*(size_t)nlevel*sizeof(*table));
+    mask = 4*(size_t)nlevel - 1;
+    for (int k=0; k<nlevel; k++) {
+      SEXP lev = STRING_ELT(levels, k);
+      size_t s = strHash(CHAR(lev), LENGTH(lev)) & mask;
+      while (table[s]) s = (s+1) & mask;
+      table[s] = k+1;
+    }
+    slot = h & mask;
+    while (table[slot]) slot = (slot+1) & mask;
+  }
+  SET_STRING_ELT(levels, nlevel, mkCharLenCE(str, len, ienc));
+  table[slot] = nlevel+1;
+  (*nMkChar)++;
+  return factorNlevel[j] = nlevel+1;
+}
+
 void pushBuffer(ThreadLocalFreadParsingContext *ctx)
 {
   const void *buff8 = ctx->buff8;
@@ -563,95 +971,165 @@ void pushBuffer(ThreadLocalFreadParsingContext *ctx)
   const char *anchor = ctx->anchor;
   int nRows = (int) ctx->nRows;
   size_t DTi = ctx->DTi;
-  int rowSize8 = (int) ctx->rowSize8;
-  int rowSize4 = (int) ctx->rowSize4;
-  int rowSize1 = (int) ctx->rowSize1;
+  size_t buffRows = ctx->buffRows;
   int nStringCols = ctx->nStringCols;
   int nNonStringCols = ctx->nNonStringCols;
 
   // Do all the string columns first so as to minimize and concentrate the time inside the single critical.
   // While the string columns are happening other threads before me can be copying their non-string buffers to the
   // final DT and other threads after me can be filling their buffers too.
-  // rowSize is passed in because it will be different (much smaller) on the reread covering any type exception columns
+  // The buffers are column-major: the column at byte offset off within a row of its buffer starts off*buffRows bytes in
   // locals passed in on stack so openmp knows that no synchronization is required
 
-  // the byte position of this column in the first row of the row-major buffer
+  // mkCharLenCE inserts into R's global CHARSXP cache so it must be called by one thread at a time. Everything else is
+  // done before the critical by this thread alone: stripping embedded nuls and, via strFirst, finding which cells repeat
+  // an earlier cell of the same column in this chunk. Inside the critical each distinct value then needs one mkCharLenCE
+  // and repeats just reuse that CHARSXP; low cardinality columns (codes, categories) thus spend far less time serialized.
   if (nStringCols) {
+    lenOff *buff8_lenoffs = (lenOff*) buff8;
+    const size_t nFirst = (size_t)nRows * nStringCols;
+    if (ctx->strNoDedup && ctx->strFirstAlloc < nFirst) {
+      free(ctx->strFirst);
+      ctx->strFirstAlloc = 0;
+      if ((ctx->strFirst = malloc(nFirst * sizeof(*ctx->strFirst)))) ctx->strFirstAlloc = nFirst;
+    }
+    size_t tableSize = 64;
+    while (tableSize < 2*(size_t)nRows) tableSize *= 2;
+    if (ctx->strFirstAlloc && ctx->strTableAlloc < tableSize) {
+      free(ctx->strTable);
+      ctx->strTableAlloc = 0;
+      if ((ctx->strTable = malloc(tableSize * sizeof(*ctx->strTable)))) ctx->strTableAlloc = tableSize;
+    }
+    const bool dedup = ctx->strFirstAlloc >= nFirst && ctx->strTableAlloc >= tableSize;  // else (out of memory) mkCharLenCE every cell as before
+    int32_t *first = ctx->strFirst;
+    int64_t nCells = 0;
+    for (int j=0, off8=0, done=0; done<nStringCols && j<ncol; j++) {
+      if (type[j] == CT_STRING) {
+        lenOff *column = buff8_lenoffs + off8*buffRows, *source = column;
+        const bool lookForRepeats = dedup && !ctx->strNoDedup[j];
+        if (lookForRepeats) for (size_t k=0; k<tableSize; k++) ctx->strTable[k] = -1;
+        int nDistinct = 0, nNonEmpty = 0;
+        for (int i=0; i<nRows; i++, source++) {
+          int strLen = source->len;
+          if (strLen<=0) {
+            // stringLen == INT_MIN => NA, otherwise not a NAstring was checked inside fread_mean
+            if (dedup) first[i] = -1;
+            continue;
+          }
+          const char *str = anchor + source->off;
+          int c=0;
+          while (c<strLen && str[c]) c++;
+          if (c<strLen) {
+            // embedded nul found; any at the beginning or the end of the field should have already been excluded but this will strip those too if present just in case
+            char *last = (char *)str+c;    // obtain write access to (const char *)anchor;
+            while (c<strLen) {
+              if (str[c]) *last++=str[c];  // cow page write: saves allocation and management of a temp that would need to thread-safe in future.
+              c++;                         //   This is only thread accessing this region. For non-mmap direct input nul are not possible (R would not have accepted nul earlier).
+            }
+            source->len = strLen = last-str;  // our own buffer; the stripped length is what mkCharLenCE needs below
+          }
+          nNonEmpty++;
+          if (!dedup) continue;
+          if (!lookForRepeats) { first[i] = i; continue; }
+          size_t slot = strHash(str, strLen) & (tableSize-1);
+          int32_t prev;
+          while ((prev = ctx->strTable[slot]) != -1) {
+            const lenOff *p = column + prev;
+            if (p->len==strLen && memcmp(anchor + p->off, str, strLen)==0) break;
+            slot = (slot+1) & (tableSize-1);
+          }
+          if (prev == -1) {
+            ctx->strTable[slot] = first[i] = i;
+            nDistinct++;
+          } else {
+            first[i] = prev;
+          }
+        }
+        // hashing mostly distinct values (ids, free text) is wasted work so this thread stops doing it for this column
+        if (lookForRepeats && nNonEmpty>=100 && nDistinct > 0.9*nNonEmpty) ctx->strNoDedup[j] = true;
+        nCells += nNonEmpty;
+        if (dedup) first += nRows;
+        done++;
+      }
+      off8 += (size[j] == 8);
+    }
+
+    double tWait = verbose ? wallclock() : 0;
     #pragma omp critical
     {
-      int off8 = 0;
-      int cnt8 = rowSize8 / 8;
-      lenOff *buff8_lenoffs = (lenOff*) buff8;
-      for (int j=0, resj=-1, done=0; done<nStringCols && j<ncol; j++) {
+      double tIn = verbose ? wallclock() : 0;
+      int64_t nMkChar = 0;
+      first = ctx->strFirst;
+      for (int j=0, resj=-1, off8=0, done=0; done<nStringCols && j<ncol; j++) {
         if (type[j] == CT_DROP) continue;
         resj++;
-        if (type[j] == CT_STRING) {
+        if (type[j] == CT_STRING && asFactor && asFactor[j]) {
+          int *dest = INTEGER(VECTOR_ELT(DT, resj)) + DTi;
+          const lenOff *source = buff8_lenoffs + off8*buffRows;
+          for (int i=0; i<nRows; i++, source++) {
+            const int strLen = source->len;
+            if (strLen<0) {
+              dest[i] = NA_INTEGER;
+            } else if (!dedup || strLen==0 || first[i]==i) {
+              const char *str = anchor + source->off;
+              int len = strLen;
+              if (jsonl) jsonUnescape(&str, &len);
+              dest[i] = factorCode(j, str, len, &nMkChar);
+            } else {
+              dest[i] = dest[first[i]];
+            }
+          }
+          if (dedup) first += nRows;
+          done++;
+        } else if (type[j] == CT_STRING) {
           SEXP dest = VECTOR_ELT(DT, resj);
-          lenOff *source = buff8_lenoffs + off8;
-          for (int i=0; i<nRows; i++) {
-            int strLen = source->len;
+          const lenOff *source = buff8_lenoffs + off8*buffRows;
+          for (int i=0; i<nRows; i++, source++) {
+            const int strLen = source->len;
             if (strLen<=0) {
-              // stringLen == INT_MIN => NA, otherwise not a NAstring was checked inside fread_mean
               if (strLen<0) SET_STRING_ELT(dest, DTi+i, NA_STRING); // else leave the "" in place that was initialized by allocVector()
-            } else {
+            } else if (!dedup || first[i]==i) {
               const char *str = anchor + source->off;
-              int c=0;
-              while (c<strLen && str[c]) c++;
-              if (c<strLen) {
-                // embedded nul found; any at the beginning or the end of the field should have already been excluded but this will strip those too if present just in case
-                char *last = (char *)str+c;    // obtain write access to (const char *)anchor;
-                while (c<strLen) {
-                  if (str[c]) *last++=str[c];  // cow page write: saves allocation and management of a temp that would need to thread-safe in future.
-                  c++;                         //   This is only thread accessing this region. For non-mmap direct input nul are not possible (R would not have accepted nul earlier).
-                }
-                strLen = last-str;
-              }
-              SET_STRING_ELT(dest, DTi+i, mkCharLenCE(str, strLen, ienc));
+              int len = strLen;
+              if (jsonl) jsonUnescape(&str, &len);
+              SET_STRING_ELT(dest, DTi+i, mkCharLenCE(str, len, ienc));
+              nMkChar++;
+            } else {
+              SET_STRING_ELT(dest, DTi+i, STRING_ELT(dest, DTi+first[i]));
             }
-            source += cnt8;
           }
+          if (dedup) first += nRows;
           done++; // if just one string col near the start, don't loop over the other 10,000 cols. TODO? start on first too
         }
         off8 += (size[j] == 8);
       }
+      if (verbose) {
+        double now = wallclock();
+        tStrWait += tIn - tWait;
+        tStrCritical += now - tIn;
+        nStrCells += nCells;
+        nStrMkChar += nMkChar;
+      }
     }
   }
 
-  int off1 = 0, off4 = 0, off8 = 0;
+  size_t off1 = 0, off4 = 0, off8 = 0;
   for (int j=0, resj=-1, done=0; done<nNonStringCols && j<ncol; j++) {
     if (type[j]==CT_DROP) continue;
     int thisSize = size[j];
     resj++;
     if (type[j]!=CT_STRING && type[j]>0) {
       if (thisSize == 8) {
-        double *dest = REAL(VECTOR_ELT(DT, resj)) + DTi;
-        const char *src8 = (char*)buff8 + off8;
-        for (int i=0; i<nRows; ++i) {
-          *dest = *(double *)src8;
-          src8 += rowSize8;
-          dest++;
-        }
+        memcpy(REAL(VECTOR_ELT(DT, resj)) + DTi, (const char *)buff8 + off8*buffRows, (size_t)nRows*8);
       } else
       if (thisSize == 4) {
-        int *dest = INTEGER(VECTOR_ELT(DT, resj)) + DTi;
-        const char *src4 = (char*)buff4 + off4;
-        // debug line for #3369 ... if (DTi>2638000) printf("freadR.c:460: thisSize==4, resj=%d, %"PRIu64", %d, %d, j=%d, done=%d\n", resj, (uint64_t)DTi, off4, rowSize4, j, done);
-        for (int i=0; i<nRows; ++i) {
-          *dest = *(int *)src4;
-          src4 += rowSize4;
-          dest++;
-        }
+        memcpy(INTEGER(VECTOR_ELT(DT, resj)) + DTi, (const char *)buff4 + off4*buffRows, (size_t)nRows*4);
       } else
       if (thisSize == 1) {
         if (type[j] > CT_BOOL8_Y) STOP(_("Field size is 1 but the field is of type %d\n"), type[j]);
         int *dest = LOGICAL(VECTOR_ELT(DT, resj)) + DTi;
-        const char *src1 = (char*)buff1 + off1;
-        for (int i=0; i<nRows; ++i) {
-          int8_t v = *(int8_t *)src1;
-          *dest = (v==INT8_MIN ? NA_INTEGER : v);
-          src1 += rowSize1;
-          dest++;
-        }
+        const int8_t *src1 = (const int8_t *)buff1 + off1*buffRows;
+        for (int i=0; i<nRows; ++i) dest[i] = (src1[i]==INT8_MIN ? NA_INTEGER : src1[i]);
       } else internal_error(__func__, "unexpected field of size %d\n", thisSize);  // # nocov
       done++;
     }
@@ -723,7 +1201,26 @@ void halt__(bool warn, const char *format, ...) {
   error("%s", msg); // # notranslate. include "%s" because data in msg might include '%'
 }
 
-void prepareThreadContext(ThreadLocalFreadParsingContext *ctx) {}
+void prepareThreadContext(ThreadLocalFreadParsingContext *ctx) {
+  // scratch for pushBuffer's string deduplication; left NULL (no deduplication) if it can't be allocated
+  ctx->strNoDedup = ctx->nStringCols ? calloc(ncol, sizeof(*ctx->strNoDedup)) : NULL;
+}
 void postprocessBuffer(ThreadLocalFreadParsingContext *ctx) {}
 void orderBuffer(ThreadLocalFreadParsingContext *ctx) {}
-void freeThreadContext(ThreadLocalFreadParsingContext *ctx) {}
+void freeThreadContext(ThreadLocalFreadParsingContext *ctx) {
+  free(ctx->strFirst);   ctx->strFirst = NULL;   ctx->strFirstAlloc = 0;
+  free(ctx->strTable);   ctx->strTable = NULL;   ctx->strTableAlloc = 0;
+  free(ctx->strNoDedup); ctx->strNoDedup = NULL;
+}
+
+SEXP gzipSizesR(SEXP file) {
+  // fread() at R level inflates a gzip file in memory only when it will fit; see gzipInflatedSize() in fread.c
+  if (!isString(file) || LENGTH(file)!=1)
+    internal_error(__func__, "file is not a single string");  // # nocov
+  SEXP ans = PROTECT(allocVector(REALSXP, 2));
+  const double size = gzipInflatedSize(R_ExpandFileName(translateChar(STRING_ELT(file, 0)))), avail = availableRAM();
+  REAL(ans)[0] = size<0 ? NA_REAL : size;
+  REAL(ans)[1] = avail<0 ? NA_REAL : avail;
+  UNPROTECT(1);
+  return ans;
+}
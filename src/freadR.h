@@ -12,7 +12,11 @@
 
 #define FREAD_PUSH_BUFFERS_EXTRA_FIELDS \
   int nStringCols; \
-  int nNonStringCols;
+  int nNonStringCols; \
+  int32_t *strFirst;   /* thread-local scratch for pushBuffer: row of the first occurrence of each string in the chunk */ \
+  int32_t *strTable;   /* thread-local open addressing hash table used to find those first occurrences */ \
+  size_t strFirstAlloc, strTableAlloc; \
+  bool *strNoDedup;    /* per column: true once a chunk of it was found to be mostly distinct, so stop looking for repeats */
 
 // Before error() [or warning() with options(warn=2)] call freadCleanup() to close mmp and fix :
 //   http://stackoverflow.com/questions/18597123/fread-data-table-locks-files
@@ -7,14 +7,22 @@
 #include <math.h>      // isfinite, isnan
 #include <stdlib.h>    // abs
 #include <string.h>    // strlen, strerror
+#include <time.h>      // nanosleep
 #ifndef NOZLIB
 #include <zlib.h>      // for compression to .gz
 #endif
+#ifndef NOZSTD
+#include <zstd.h>      // for compression to .zst
+#endif
+#ifndef NOLZ4
+#include <lz4frame.h>  // for compression to .lz4
+#endif
 
 #ifdef WIN32
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <io.h>
+#include <windows.h>   // Sleep
 #define WRITE _write
 #define CLOSE _close
 #else
@@ -40,6 +48,7 @@ static int8_t doQuote=INT8_MIN;        // whether to surround fields with double
 static bool qmethodEscape=false;       // when quoting fields, how to escape double quotes in the field contents (default false means to add another double quote)
 static int scipen;
 static bool squashDateTime=false;      // 0=ISO(yyyy-mm-dd) 1=squash(yyyymmdd)
+static bool roundtrip=false;           // shortest digits that read back to the identical double, rather than 15 significant digits
 static bool verbose=false;
 static int gzip_level;
 
@@ -60,17 +69,20 @@ inline void write_chars(const char *x, char **pch)
   *pch = ch;
 }
 
-void writeBool8(const void *col, int64_t row, char **pch)
+static inline void write_bool8(int8_t x, char **pch)
 {
-  int8_t x = ((const int8_t *)col)[row];
   char *ch = *pch;
   *ch++ = '0'+(x==1);
   *pch = ch-(x==INT8_MIN);  // if NA then step back, to save a branch
 }
 
-void writeBool32(const void *col, int64_t row, char **pch)
+void writeBool8(const void *col, int64_t row, char **pch)
+{
+  write_bool8(((const int8_t *)col)[row], pch);
+}
+
+static inline void write_bool32(int32_t x, char **pch)
 {
-  int32_t x = ((const int32_t *)col)[row];
   char *ch = *pch;
   if (x==INT32_MIN) {  // TODO: when na=='\0' as recommended, use a branchless writer
     write_chars(na, &ch);
@@ -80,9 +92,13 @@ void writeBool32(const void *col, int64_t row, char **pch)
   *pch = ch;
 }
 
-void writeBool32AsString(const void *col, int64_t row, char **pch)
+void writeBool32(const void *col, int64_t row, char **pch)
+{
+  write_bool32(((const int32_t *)col)[row], pch);
+}
+
+static inline void write_bool32_as_string(int32_t x, char **pch)
 {
-  int32_t x = ((const int32_t *)col)[row];
   char *ch = *pch;
   if (x == INT32_MIN) {
     write_chars(na, &ch);
@@ -94,6 +110,11 @@ void writeBool32AsString(const void *col, int64_t row, char **pch)
   *pch = ch;
 }
 
+void writeBool32AsString(const void *col, int64_t row, char **pch)
+{
+  write_bool32_as_string(((const int32_t *)col)[row], pch);
+}
+
 static inline void reverse(char *upp, char *low)
 {
   upp--;
@@ -106,10 +127,9 @@ static inline void reverse(char *upp, char *low)
   }
 }
 
-void writeInt32(const void *col, int64_t row, char **pch)
+static inline void write_int32(int32_t x, char **pch)
 {
   char *ch = *pch;
-  int32_t x = ((const int32_t *)col)[row];
   if (x == INT32_MIN) {
     write_chars(na, &ch);
   } else {
@@ -122,10 +142,14 @@ void writeInt32(const void *col, int64_t row, char **pch)
   *pch = ch;
 }
 
-void writeInt64(const void *col, int64_t row, char **pch)
+void writeInt32(const void *col, int64_t row, char **pch)
+{
+  write_int32(((const int32_t *)col)[row], pch);
+}
+
+static inline void write_int64(int64_t x, char **pch)
 {
   char *ch = *pch;
-  int64_t x = ((const int64_t *)col)[row];
   if (x == INT64_MIN) {
     write_chars(na, &ch);
   } else {
@@ -137,6 +161,11 @@ void writeInt64(const void *col, int64_t row, char **pch)
   *pch = ch;
 }
 
+void writeInt64(const void *col, int64_t row, char **pch)
+{
+  write_int64(((const int64_t *)col)[row], pch);
+}
+
 /*
  * Generate fwriteLookup.h which defines sigparts, expsig and exppow that writeNumeric() that follows uses.
  * It was run once a long time ago in dev and we don't need to generate it again unless we change it.
@@ -177,7 +206,168 @@ void genLookups() {
 }
 */
 
-void writeFloat64(const void *col, int64_t row, char **pch)
+/*
+ * Ryu, Ulf Adams, PLDI 2018 (https://github.com/ulfjack/ryu, Apache 2.0 or Boost 1.0): the shortest decimal
+ * digits that read back to exactly the same double, for roundtrip=TRUE. Only the 64 bit core (d2d) is needed
+ * here; write_float64() below lays out the digits with its usual decimal/scientific and scipen rules.
+ */
+#if defined(__SIZEOF_INT128__)
+static inline uint64_t ryu_mulShift64(uint64_t m, const uint64_t *mul, int32_t j)
+{
+  // (m * (mul[1]*2^64 + mul[0])) >> j, with 64 < j < 128
+  const unsigned __int128 b0 = (unsigned __int128)m * mul[0];
+  const unsigned __int128 b2 = (unsigned __int128)m * mul[1];
+  return (uint64_t)(((b0 >> 64) + b2) >> (j - 64));
+}
+#else
+static inline uint64_t ryu_umul128(uint64_t a, uint64_t b, uint64_t *hi)
+{
+  const uint64_t aLo = (uint32_t)a, aHi = a >> 32, bLo = (uint32_t)b, bHi = b >> 32;
+  const uint64_t b00 = aLo * bLo, b01 = aLo * bHi, b10 = aHi * bLo, b11 = aHi * bHi;
+  const uint64_t mid1 = b10 + (b00 >> 32);
+  const uint64_t mid2 = b01 + (uint32_t)mid1;
+  *hi = b11 + (mid1 >> 32) + (mid2 >> 32);
+  return (mid2 << 32) | (uint32_t)b00;
+}
+
+static inline uint64_t ryu_mulShift64(uint64_t m, const uint64_t *mul, int32_t j)
+{
+  uint64_t high0, high1;
+  ryu_umul128(m, mul[0], &high0);
+  const uint64_t low1 = ryu_umul128(m, mul[1], &high1);
+  const uint64_t sum = high0 + low1;
+  high1 += sum < high0;
+  const int32_t dist = j - 64;  // in [51,64) for doubles
+  return (high1 << (64 - dist)) | (sum >> dist);
+}
+#endif
+
+static inline int ryu_pow5bits(int32_t e) { return ((e * 1217359) >> 19) + 1; }  // bits in 5^e, e in [0,3528]
+static inline int ryu_log10Pow2(int32_t e) { return (e * 78913) >> 18; }         // floor(log10(2^e)), e in [0,1650]
+static inline int ryu_log10Pow5(int32_t e) { return (e * 732923) >> 20; }        // floor(log10(5^e)), e in [0,2620]
+
+static inline bool ryu_multipleOfPow5(uint64_t x, int p)
+{
+  int count = 0;
+  while (x % 5 == 0) { x /= 5; count++; }  // x>0 always here
+  return count >= p;
+}
+
+static inline int ryu_digits(uint64_t ieeeMantissa, int ieeeExponent, uint64_t *digits)
+// x = *digits * 10^(returned value) exactly where *digits has as few digits as possible while still reading back to x.
+// x must be finite and >0.
+{
+  if (ieeeExponent >= 1023 && ieeeExponent <= 1023+52) {
+    // whole numbers in [1,2^53) are exact, so their own digits are the shortest; e.g. quantities
+    const int shift = 1023+52 - ieeeExponent;
+    const uint64_t m = (1ull << 52) | ieeeMantissa;
+    if ((m & ((1ull << shift) - 1)) == 0) {
+      *digits = m >> shift;
+      return 0;
+    }
+  }
+  int32_t e2;
+  uint64_t m2;
+  if (ieeeExponent == 0) {  // subnormal
+    e2 = 1 - 1023 - 52 - 2;
+    m2 = ieeeMantissa;
+  } else {
+    e2 = ieeeExponent - 1023 - 52 - 2;
+    m2 = (1ull << 52) | ieeeMantissa;
+  }
+  const bool acceptBounds = (m2 & 1) == 0;  // round half to even when reading back means the interval is closed
+
+  // The interval of decimal values that read back to x is (mv-mm, mv+2)/4 * 2^(e2+2), in the exponent of the next step
+  const uint64_t mv = 4 * m2;
+  const uint32_t mmShift = ieeeMantissa != 0 || ieeeExponent <= 1;  // the gap below is half the gap above at a power of 2
+
+  // Convert the interval to decimal, to vm,vr,vp * 10^e10
+  uint64_t vr, vp, vm;
+  int32_t e10;
+  bool vmIsTrailingZeros = false, vrIsTrailingZeros = false;
+  if (e2 >= 0) {
+    const int32_t q = ryu_log10Pow2(e2) - (e2 > 3);
+    e10 = q;
+    const int32_t k = 125 + ryu_pow5bits(q) - 1;
+    const int32_t i = -e2 + q + k;
+    vr = ryu_mulShift64(4 * m2, ryuPow5InvSplit[q], i);
+    vp = ryu_mulShift64(4 * m2 + 2, ryuPow5InvSplit[q], i);
+    vm = ryu_mulShift64(4 * m2 - 1 - mmShift, ryuPow5InvSplit[q], i);
+    if (q <= 21) {
+      // Only mv (<2^55) that are multiples of 5^q can have been divided exactly
+      if (mv % 5 == 0) {
+        vrIsTrailingZeros = ryu_multipleOfPow5(mv, q);
+      } else if (acceptBounds) {
+        vmIsTrailingZeros = ryu_multipleOfPow5(mv - 1 - mmShift, q);
+      } else {
+        vp -= ryu_multipleOfPow5(mv + 2, q);
+      }
+    }
+  } else {
+    const int32_t q = ryu_log10Pow5(-e2) - (-e2 > 1);
+    e10 = q + e2;
+    const int32_t i = -e2 - q;
+    const int32_t k = ryu_pow5bits(i) - 125;
+    const int32_t j = q - k;
+    vr = ryu_mulShift64(4 * m2, ryuPow5Split[i], j);
+    vp = ryu_mulShift64(4 * m2 + 2, ryuPow5Split[i], j);
+    vm = ryu_mulShift64(4 * m2 - 1 - mmShift, ryuPow5Split[i], j);
+    if (q <= 1) {
+      // mv, mp and mm all have at least q trailing 0 bits
+      vrIsTrailingZeros = true;
+      if (acceptBounds) {
+        vmIsTrailingZeros = mmShift == 1;
+      } else {
+        vp--;
+      }
+    } else if (q < 63) {
+      vrIsTrailingZeros = (mv & ((1ull << q) - 1)) == 0;
+    }
+  }
+
+  // Remove digits while vp and vm still differ: the shortest digits inside the interval, rounded from vr
+  int32_t removed = 0;
+  uint64_t output;
+  if (vmIsTrailingZeros || vrIsTrailingZeros) {
+    // rare (~0.7%): exact decimal bounds or an exact tie need tracking
+    int lastRemovedDigit = 0;
+    while (vp / 10 > vm / 10) {
+      vmIsTrailingZeros &= vm % 10 == 0;
+      vrIsTrailingZeros &= lastRemovedDigit == 0;
+      lastRemovedDigit = vr % 10;
+      vr /= 10; vp /= 10; vm /= 10;
+      removed++;
+    }
+    if (vmIsTrailingZeros) {
+      while (vm % 10 == 0) {
+        vrIsTrailingZeros &= lastRemovedDigit == 0;
+        lastRemovedDigit = vr % 10;
+        vr /= 10; vp /= 10; vm /= 10;
+        removed++;
+      }
+    }
+    if (vrIsTrailingZeros && lastRemovedDigit == 5 && vr % 2 == 0)
+      lastRemovedDigit = 4;  // exactly .5 so round to even
+    output = vr + ((vr == vm && (!acceptBounds || !vmIsTrailingZeros)) || lastRemovedDigit >= 5);
+  } else {
+    bool roundUp = false;
+    if (vp / 100 > vm / 100) {  // two at a time first (~86%)
+      roundUp = vr % 100 >= 50;
+      vr /= 100; vp /= 100; vm /= 100;
+      removed += 2;
+    }
+    while (vp / 10 > vm / 10) {
+      roundUp = vr % 10 >= 5;
+      vr /= 10; vp /= 10; vm /= 10;
+      removed++;
+    }
+    output = vr + (vr == vm || roundUp);
+  }
+  *digits = output;
+  return e10 + removed;
+}
+
+static inline void write_float64(double x, char **pch)
 {
   // hand-rolled / specialized for speed
   // *pch is safely the output destination with enough space (ensured via calculating maxLineLen up front)
@@ -187,7 +377,6 @@ void writeFloat64(const void *col, int64_t row, char **pch)
   //  ii) no C library calls such as sprintf() where the fmt string has to be interpreted over and over
   // iii) no need to return variables or flags.  Just writes.
   //  iv) shorter, easier to read and reason with in one self contained place.
-  double x = ((const double *)col)[row];
   char *ch = *pch;
   if (!isfinite(x)) {
     if (isnan(x)) {
@@ -204,111 +393,127 @@ void writeFloat64(const void *col, int64_t row, char **pch)
     u.d = x;
     uint64_t fraction = u.l & 0xFFFFFFFFFFFFF;           // (1<<52)-1;
     uint32_t exponent = (int32_t)((u.l>>52) & 0x7FF);    // [0,2047]
-
-    // Now sum the appropriate powers 2^-(1:52) of the fraction
-    // Important for accuracy to start with the smallest first; i.e. 2^-52
-    // Exact powers of 2 (1.0, 2.0, 4.0, etc) are represented precisely with fraction==0
-    // Skip over tailing zeros for exactly representable numbers such 0.5, 0.75
-    // Underflow here (0u-1u = all 1s) is on an unsigned type which is ok by C standards
-    // sigparts[0] arranged to be 0.0 in genLookups() to enable branch free loop here
-    double acc = 0;  // 'long double' not needed
-    int i = 52;
-    if (fraction) {
-      while ((fraction & 0xFF) == 0) { fraction >>= 8; i-=8; }
-      while (fraction) {
-        acc += sigparts[(((fraction & 1u)^1u)-1u) & i];
-        i--;
-        fraction >>= 1;
-      }
-    }
-    // 1.0+acc is in range [1.5,2.0) by IEEE754
-    // expsig is in range [1.0,10.0) by design of fwriteLookups.h
-    // Therefore y in range [1.5,20.0)
-    // Avoids (potentially inaccurate and potentially slow) log10/log10l, pow/powl, ldexp/ldexpl
-    // By design we can just lookup the power from the tables
-    double y = (1.0+acc) * expsig[exponent];  // low magnitude mult
-    int exp = exppow[exponent];
-    if (y>=9.99999999999999) { y /= 10; exp++; }
-    uint64_t l = y * SIZE_SF;  // low magnitude mult 10^NUM_SF
-    // l now contains NUM_SF+1 digits as integer where repeated /10 below is accurate
-
-    // if (verbose) Rprintf(_("\nTRACE: acc=%.20Le ; y=%.20Le ; l=%"PRIu64" ; e=%d     "), acc, y, l, exp);
-
-    if (l%10 >= 5) l+=10; // use the last digit to round
-    l /= 10;
-    if (l == 0) {
-      if (*(ch-1)=='-') ch--;
-      *ch++ = '0';
+    uint64_t l;
+    int sf, exp;
+    if (roundtrip) {
+      exp = ryu_digits(fraction, exponent, &l);
+      while (l%10 == 0) { l /= 10; exp++; }
+      sf = 1;
+      for (uint64_t t=l; t>=10; t/=10) sf++;
+      exp += sf-1;  // now the power of 10 of the first digit, as below
     } else {
+      // Now sum the appropriate powers 2^-(1:52) of the fraction
+      // Important for accuracy to start with the smallest first; i.e. 2^-52
+      // Exact powers of 2 (1.0, 2.0, 4.0, etc) are represented precisely with fraction==0
+      // Skip over tailing zeros for exactly representable numbers such 0.5, 0.75
+      // Underflow here (0u-1u = all 1s) is on an unsigned type which is ok by C standards
+      // sigparts[0] arranged to be 0.0 in genLookups() to enable branch free loop here
+      double acc = 0;  // 'long double' not needed
+      int i = 52;
+      if (fraction) {
+        while ((fraction & 0xFF) == 0) { fraction >>= 8; i-=8; }
+        while (fraction) {
+          acc += sigparts[(((fraction & 1u)^1u)-1u) & i];
+          i--;
+          fraction >>= 1;
+        }
+      }
+      // 1.0+acc is in range [1.5,2.0) by IEEE754
+      // expsig is in range [1.0,10.0) by design of fwriteLookups.h
+      // Therefore y in range [1.5,20.0)
+      // Avoids (potentially inaccurate and potentially slow) log10/log10l, pow/powl, ldexp/ldexpl
+      // By design we can just lookup the power from the tables
+      double y = (1.0+acc) * expsig[exponent];  // low magnitude mult
+      exp = exppow[exponent];
+      if (y>=9.99999999999999) { y /= 10; exp++; }
+      l = y * SIZE_SF;  // low magnitude mult 10^NUM_SF
+      // l now contains NUM_SF+1 digits as integer where repeated /10 below is accurate
+
+      // if (verbose) Rprintf(_("\nTRACE: acc=%.20Le ; y=%.20Le ; l=%"PRIu64" ; e=%d     "), acc, y, l, exp);
+
+      if (l%10 >= 5) l+=10; // use the last digit to round
+      l /= 10;
+      if (l == 0) {
+        if (*(ch-1)=='-') ch--;
+        *ch++ = '0';
+        *pch = ch;
+        return;
+      }
       // Count trailing zeros and therefore s.f. present in l
       int trailZero = 0;
       while (l%10 == 0) { l /= 10; trailZero++; }
-      int sf = NUM_SF - trailZero;
+      sf = NUM_SF - trailZero;
       if (sf==0) {sf=1; exp++;}  // e.g. l was 9999999[5-9] rounded to 10000000 which added 1 digit
+    }
 
-      // l is now an unsigned long that doesn't start or end with 0
-      // sf is the number of digits now in l
-      // exp is e<exp> were l to be written with the decimal sep after the first digit
-      int dr = sf-exp-1; // how many characters to print to the right of the decimal place
-      int width=0;       // field width were it written decimal format. Used to decide whether to or not.
-      int dl0=0;         // how many 0's to add to the left of the decimal place before starting l
-      if (dr<=0) { dl0 = -dr; dr=0; width=sf+dl0; }  // 1, 10, 100, 99000
-      else {
-        if (sf>dr) width=sf+1;                     // 1.234 and 123.4
-        else { dl0=1; width=dr+1+dl0; }            // 0.1234, 0.0001234
+    // l is now an unsigned long that doesn't start or end with 0
+    // sf is the number of digits now in l
+    // exp is e<exp> were l to be written with the decimal sep after the first digit
+    int dr = sf-exp-1; // how many characters to print to the right of the decimal place
+    int width=0;       // field width were it written decimal format. Used to decide whether to or not.
+    int dl0=0;         // how many 0's to add to the left of the decimal place before starting l
+    if (dr<=0) { dl0 = -dr; dr=0; width=sf+dl0; }  // 1, 10, 100, 99000
+    else {
+      if (sf>dr) width=sf+1;                     // 1.234 and 123.4
+      else { dl0=1; width=dr+1+dl0; }            // 0.1234, 0.0001234
+    }
+    // So:  3.1416 => l=31416, sf=5, exp=0     dr=4; dl0=0; width=6
+    //      30460  => l=3046, sf=4, exp=4      dr=0; dl0=1; width=5
+    //      0.0072 => l=72, sf=2, exp=-3       dr=4; dl0=1; width=6
+    // With roundtrip, whole numbers of more than 18 digits are written in scientific format since fread reads those as string
+    if (width <= sf + (sf>1) + 2 + (abs(exp)>99?3:2) + scipen && !(roundtrip && dr==0 && width>18)) {
+      //               ^^^^ to not include 1 char for dec in -7e-04 where sf==1
+      //                       ^ 2 for 'e+'/'e-'
+      // decimal format ...
+      ch += width-1;
+      if (dr) {
+        while (dr && sf) { *ch--='0'+l%10; l/=10; dr--; sf--; }
+        while (dr) { *ch--='0'; dr--; }
+        *ch-- = dec;
       }
-      // So:  3.1416 => l=31416, sf=5, exp=0     dr=4; dl0=0; width=6
-      //      30460  => l=3046, sf=4, exp=4      dr=0; dl0=1; width=5
-      //      0.0072 => l=72, sf=2, exp=-3       dr=4; dl0=1; width=6
-      if (width <= sf + (sf>1) + 2 + (abs(exp)>99?3:2) + scipen) {
-        //               ^^^^ to not include 1 char for dec in -7e-04 where sf==1
-        //                       ^ 2 for 'e+'/'e-'
-        // decimal format ...
-        ch += width-1;
-        if (dr) {
-          while (dr && sf) { *ch--='0'+l%10; l/=10; dr--; sf--; }
-          while (dr) { *ch--='0'; dr--; }
-          *ch-- = dec;
-        }
-        while (dl0) { *ch--='0'; dl0--; }
-        while (sf) { *ch--='0'+l%10; l/=10; sf--; }
-        // ch is now 1 before the first char of the field so position it afterward again, and done
-        ch += width+1;
+      while (dl0) { *ch--='0'; dl0--; }
+      while (sf) { *ch--='0'+l%10; l/=10; sf--; }
+      // ch is now 1 before the first char of the field so position it afterward again, and done
+      ch += width+1;
+    } else {
+      // scientific ...
+      ch += sf;  // sf-1 + 1 for dec
+      for (int i=sf; i>1; i--) {
+        *ch-- = '0' + l%10;
+        l /= 10;
+      }
+      if (sf == 1) ch--; else *ch-- = dec;
+      *ch = '0' + l;
+      ch += sf + (sf>1);
+      *ch++ = 'e';  // lower case e to match base::write.csv
+      if (exp < 0) { *ch++ = '-'; exp = -exp; }
+      else { *ch++ = '+'; }  // to match base::write.csv
+      if (exp < 100) {
+        *ch++ = '0' + (exp / 10);
+        *ch++ = '0' + (exp % 10);
       } else {
-        // scientific ...
-        ch += sf;  // sf-1 + 1 for dec
-        for (int i=sf; i>1; i--) {
-          *ch-- = '0' + l%10;
-          l /= 10;
-        }
-        if (sf == 1) ch--; else *ch-- = dec;
-        *ch = '0' + l;
-        ch += sf + (sf>1);
-        *ch++ = 'e';  // lower case e to match base::write.csv
-        if (exp < 0) { *ch++ = '-'; exp = -exp; }
-        else { *ch++ = '+'; }  // to match base::write.csv
-        if (exp < 100) {
-          *ch++ = '0' + (exp / 10);
-          *ch++ = '0' + (exp % 10);
-        } else {
-          *ch++ = '0' + (exp / 100);
-          *ch++ = '0' + (exp / 10) % 10;
-          *ch++ = '0' + (exp % 10);
-        }
+        *ch++ = '0' + (exp / 100);
+        *ch++ = '0' + (exp / 10) % 10;
+        *ch++ = '0' + (exp % 10);
       }
     }
   }
   *pch = ch;
 }
 
+void writeFloat64(const void *col, int64_t row, char **pch)
+{
+  write_float64(((const double *)col)[row], pch);
+}
+
 void writeComplex(const void *col, int64_t row, char **pch)
 {
   Rcomplex x = ((const Rcomplex *)col)[row];
   char *ch = *pch;
-  writeFloat64(&x.r, 0, &ch);
+  write_float64(x.r, &ch);
   if (!ISNAN(x.i)) {
-    if (x.i >= 0.0) *ch++ = '+';  // else writeFloat64 writes the - sign
-    writeFloat64(&x.i, 0, &ch);
+    if (x.i >= 0.0) *ch++ = '+';  // else write_float64 writes the - sign
+    write_float64(x.i, &ch);
     *ch++ = 'i';
   }
   *pch = ch;
@@ -398,12 +603,15 @@ void writeDateInt32(const void *col, int64_t row, char **pch) {
   write_date(((const int32_t *)col)[row], pch);
 }
 
-void writeDateFloat64(const void *col, int64_t row, char **pch) {
-  double x = ((const double *)col)[row];
+static inline void write_date_float64(double x, char **pch) {
   write_date(isfinite(x) ? (int)(x) : INT32_MIN, pch);
 }
 
-void writePOSIXct(const void *col, int64_t row, char **pch)
+void writeDateFloat64(const void *col, int64_t row, char **pch) {
+  write_date_float64(((const double *)col)[row], pch);
+}
+
+static inline void write_posixct(double x, char **pch)
 {
   // Write ISO8601 UTC by default to encourage ISO standards, stymie ambiguity and for speed.
   // R internally represents POSIX datetime in UTC always. Its 'tzone' attribute can be ignored.
@@ -412,7 +620,6 @@ void writePOSIXct(const void *col, int64_t row, char **pch)
   // All positive integers up to 2^53 (9e15) are exactly representable by double which is relied
   // on in the ops here; number of seconds since epoch.
 
-  double x = ((const double *)col)[row];
   char *ch = *pch;
   if (!isfinite(x)) {
     write_chars(na, &ch);
@@ -465,6 +672,11 @@ void writePOSIXct(const void *col, int64_t row, char **pch)
   *pch = ch;
 }
 
+void writePOSIXct(const void *col, int64_t row, char **pch)
+{
+  write_posixct(((const double *)col)[row], pch);
+}
+
 // # nocov start. Covered in other.Rraw test 22, not the main suite.
 void writeNanotime(const void *col, int64_t row, char **pch)
 {
@@ -500,6 +712,33 @@ void writeNanotime(const void *col, int64_t row, char **pch)
 }
 // # nocov end
 
+// Batch versions of the fixed width writers above. Each loops over a slice of one column calling the inline
+// helper directly, so the loop holds the column pointer, na, dec and so on in registers for the whole slice
+// rather than paying an indirect call per cell.
+#define BATCH_WRITER(fun, type, helper)                                                \
+void fun##Batch(const void *col, int64_t from, int64_t to, char **pch, int32_t *widths) \
+{                                                                                      \
+  const type *x = (const type *)col;                                                   \
+  char *ch = *pch;                                                                     \
+  for (int64_t i=from; i<to; i++) {                                                    \
+    char *low = ch;                                                                    \
+    helper(x[i], &ch);                                                                 \
+    *widths++ = ch-low;                                                                \
+  }                                                                                    \
+  *pch = ch;                                                                           \
+}
+
+BATCH_WRITER(writeBool8,          int8_t,  write_bool8)
+BATCH_WRITER(writeBool32,         int32_t, write_bool32)
+BATCH_WRITER(writeBool32AsString, int32_t, write_bool32_as_string)
+BATCH_WRITER(writeInt32,          int32_t, write_int32)
+BATCH_WRITER(writeInt64,          int64_t, write_int64)
+BATCH_WRITER(writeFloat64,        double,  write_float64)
+BATCH_WRITER(writeITime,          int32_t, write_time)
+BATCH_WRITER(writeDateInt32,      int32_t, write_date)
+BATCH_WRITER(writeDateFloat64,    double,  write_date_float64)
+BATCH_WRITER(writePOSIXct,        double,  write_posixct)
+
 static inline void write_string(const char *x, char **pch)
 {
   char *ch = *pch;
@@ -590,15 +829,241 @@ int compressbuff(z_stream *stream, void* dest, size_t *destLen, const void* sour
 }
 #endif
 
+// zstd and lz4 compress each buffer as an independent frame. Both formats define a file of concatenated frames to
+// decompress as the concatenation of their contents, so unlike gzip there's no stream state to carry across buffers
+// and no trailer. Returns the compressed size, or 0 with *err set to the library's reason.
+static size_t compressframe(bool zstd, void *cctx, int level, void *dest, size_t destLen, const void *source, size_t sourceLen, const char **err)
+{
+  size_t ans = 0;
+  if (zstd) {
+#ifndef NOZSTD
+    ans = ZSTD_compressCCtx((ZSTD_CCtx *)cctx, dest, destLen, source, sourceLen, level);
+    if (ZSTD_isError(ans)) { *err = ZSTD_getErrorName(ans); ans = 0; }
+#endif
+  } else {
+#ifndef NOLZ4
+    LZ4F_preferences_t prefs = LZ4F_INIT_PREFERENCES;
+    prefs.compressionLevel = level;
+    prefs.frameInfo.contentSize = sourceLen;
+    ans = LZ4F_compressFrame(dest, destLen, source, sourceLen, &prefs);
+    if (LZ4F_isError(ans)) { *err = LZ4F_getErrorName(ans); ans = 0; }
+#endif
+  }
+  return ans;
+}
+
+static size_t frameBound(bool zstd, int level, size_t sourceLen)
+{
+#ifndef NOZSTD
+  if (zstd) return ZSTD_compressBound(sourceLen);
+#endif
+#ifndef NOLZ4
+  if (!zstd) {
+    LZ4F_preferences_t prefs = LZ4F_INIT_PREFERENCES;
+    prefs.compressionLevel = level;
+    prefs.frameInfo.contentSize = sourceLen;
+    return LZ4F_compressFrameBound(sourceLen, &prefs);
+  }
+#endif
+  return sourceLen;  // # nocov
+}
+
+static void freeCCtx(void **cctx, int n)
+{
+  if (!cctx) return;
+#ifndef NOZSTD
+  for (int i=0; i<n; i++) ZSTD_freeCCtx((ZSTD_CCtx *)cctx[i]);  // NULL is a no-op
+#endif
+  free(cctx);
+}
+
+// Output to memory (args.toMemory) is collected here, grown by doubling as it's written and trimmed to its length at the
+// end; only the writer thread (or
+// the master, for the header) writes to it. It's kept until fwriteMemoryFree() or the next fwriteMain(), which also
+// frees it if an error left it behind.
+#define MEM_OUT -2      // the file descriptor f when writing to memBuff
+static char *memBuff = NULL;
+static size_t memUsed = 0, memCap = 0;
+
+const char *fwriteMemory(size_t *len)
+{
+  *len = memUsed;
+  return memBuff;
+}
+
+void fwriteMemoryFree(void)
+{
+  free(memBuff);
+  memBuff = NULL;
+  memUsed = memCap = 0;
+}
+
+// All output other than to the console goes through here. Returns -1 on error as write() does.
+static inline int writeOut(int f, const void *buf, size_t len)
+{
+  if (f == MEM_OUT) {
+    if (memUsed + len > memCap) {
+      size_t cap = memCap < 4096 ? 4096 : 2 * memCap;
+      if (cap < memUsed + len) cap = memUsed + len;
+      char *tt = realloc(memBuff, cap);
+      if (!tt) { errno = ENOMEM; return -1; } // # nocov
+      memBuff = tt;
+      memCap = cap;
+    }
+    memcpy(memBuff + memUsed, buf, len);
+    memUsed += len;
+    return 0;
+  }
+  return WRITE(f, buf, (int)len);
+}
+
+// A batch of rows formatted (and compressed) by a formatting thread, waiting in the ring for the writer thread
+typedef struct {
+  int64_t batch;          // the batch the slot holds, set with omp atomic once the fields below are filled
+  char *buff;             // buffSize bytes
+  size_t buffUsed;
+  void *zbuff;            // zbuffSize bytes when compressing
+  size_t zbuffUsed;
+  size_t mylen;           // uncompressed length when compressing, else 0
+  unsigned long mycrc;    // gzip only
+  int failed_compress;
+  const char *failed_frame;
+} writeSlot;
+
+// What the formatting threads share for the duration of the rows loop
+typedef struct {
+  const fwriteMainArgs *args;
+  int rowsPerBatch;
+  size_t buffSize, zbuffSize;
+  const bool *batchCol;
+  int nBatchCols;
+  char *scratchPool;
+  char **posPool;
+  int32_t *widthsPool;
+  bool is_frame;
+  void **cctx;
+} batchWriter;
+
+// Waiting for the writer or a formatting thread: spin briefly since the wait is often short, then sleep for longer
+// each time, from 50us up to 1.6ms, so as not to take a core from the formatting threads
+static inline void backoff(int *spins)
+{
+  int k = ++*spins - 64;
+  if (k < 0) return;
+#ifdef WIN32
+  Sleep(k < 5 ? 0 : 1);
+#else
+  struct timespec ts = {0, 50000L << (k < 5 ? k : 5)};
+  nanosleep(&ts, NULL);
+#endif
+}
+
+// Format batch b into slot using formatting thread fi's scratch buffers and compression context, then hand it over
+static void fillSlot(const batchWriter *bw, writeSlot *slot, int64_t b, int fi, double *tFormat, double *tCompress)
+{
+  const fwriteMainArgs *args = bw->args;
+  const int rowsPerBatch = bw->rowsPerBatch;
+  const bool *batchCol = bw->batchCol;
+  const int64_t start = b * rowsPerBatch;
+  const int64_t end = (args->nrow - start) < rowsPerBatch ? args->nrow : start + rowsPerBatch;
+  double t0 = wallclock();
+  char *ch = slot->buff;
+
+  char **pos = NULL;
+  int32_t *widths = NULL;
+  if (bw->nBatchCols) {
+    char *sc = bw->scratchPool + fi * bw->buffSize;
+    pos = bw->posPool + (size_t)fi * args->ncol;
+    widths = bw->widthsPool + (size_t)fi * rowsPerBatch * args->ncol;
+    for (int j=0; j<args->ncol; j++) {
+      if (!batchCol[j]) continue;
+      pos[j] = sc;
+      (args->batchFuns[args->whichFun[j]])(args->columns[j], start, end, &sc, widths + (size_t)j * rowsPerBatch);
+    }
+  }
+
+  // chunk rows
+  for (int64_t i = start; i < end; i++) {
+    // Tepid starts here (once at beginning of each line)
+    if (args->doRowNames) {
+      if (args->rowNames==NULL) {
+        if (doQuote==1)
+          *ch++='"';
+        write_int64(i+1, &ch);
+        if (doQuote==1)
+          *ch++='"';
+      } else {
+        if (args->rowNameFun != WF_String && doQuote==1)
+          *ch++='"';
+        (args->funs[args->rowNameFun])(args->rowNames, i, &ch);  // #5098
+        if (args->rowNameFun != WF_String && doQuote==1)
+          *ch++='"';
+      }
+      *ch = sep;
+      ch += sepLen;
+    }
+    // Hot loop
+    for (int j=0; j<args->ncol; j++) {
+      if (batchCol[j]) {
+        // 8 bytes at a time; may copy up to 7 bytes past the cell which the sep and the next cell then overwrite
+        int32_t w = widths[(size_t)j * rowsPerBatch + (i-start)];
+        const char *p = pos[j];
+        for (int k=0; k<w; k+=8) memcpy(ch+k, p+k, 8);
+        pos[j] += w;
+        ch += w;
+      } else {
+        (args->funs[args->whichFun[j]])(args->columns[j], i, &ch);
+      }
+      *ch = sep;
+      ch += sepLen;
+    }
+    // Tepid again (once at the end of each line)
+    ch -= sepLen;  // backup onto the last sep after the last column. ncol>=1 because 0-columns was caught earlier.
+    write_chars(args->eol, &ch);  // overwrite last sep with eol instead
+  } // end of chunk rows loop
+  slot->buffUsed = (size_t)(ch - slot->buff);
+  slot->mylen = 0;
+  slot->failed_compress = 0;
+  slot->failed_frame = NULL;
+  double t1 = wallclock();
+  *tFormat += t1-t0;
+
+  // compress buffer if gzip, zstd or lz4
+#ifndef NOZLIB
+  if (args->is_gzip) {
+    z_stream mystream;
+    slot->zbuffUsed = bw->zbuffSize;
+    slot->mylen = slot->buffUsed;
+    if (init_stream(&mystream) != Z_OK) { // this should be thread safe according to zlib documentation
+      slot->failed_compress = -998;  // # nocov
+    } else {
+      slot->mycrc = crc32(0, (unsigned char*)slot->buff, slot->mylen);
+      slot->failed_compress = compressbuff(&mystream, slot->zbuff, &slot->zbuffUsed, slot->buff, slot->mylen);
+      deflateEnd(&mystream);
+    }
+  }
+#endif
+  if (bw->is_frame) {
+    slot->mylen = slot->buffUsed;
+    slot->zbuffUsed = compressframe(args->is_zstd, bw->cctx[fi], args->gzip_level, slot->zbuff, bw->zbuffSize, slot->buff, slot->mylen, &slot->failed_frame);
+  }
+  if (args->is_gzip || bw->is_frame)
+    *tCompress += wallclock()-t1;
+
+  #pragma omp flush
+  #pragma omp atomic write
+  slot->batch = b;
+}
+
 /*
  main fwrite function ----
 
 OpenMP is used here primarily to parallelize the process of writing rows
     to the output file, but error handling and compression (if enabled) are
     also managed within the parallel region. Special attention is paid to
-    thread safety and synchronization, especially in the ordered sections
-    where output to the file and handling of errors is serialized to maintain
-    the correct sequence of rows.
+    thread safety and synchronization between the formatting threads and the
+    writer thread, which alone writes to the file and reports errors, in the
+    correct sequence of rows, and formats batches too while it waits.
 */
 void fwriteMain(fwriteMainArgs args)
 {
@@ -624,6 +1089,14 @@ void fwriteMain(fwriteMainArgs args)
   if (args.is_gzip)
     STOP(_("Compression in fwrite uses zlib library. Its header files were not found at the time data.table was compiled. To enable fwrite compression, please reinstall data.table and study the output for further guidance.")); // # nocov
 #endif
+#ifdef NOZSTD
+  if (args.is_zstd)
+    STOP(_("compress='zstd' in fwrite uses the zstd library. Its header files were not found at the time data.table was compiled. To enable it, please install libzstd (e.g. deb: libzstd-dev, rpm: libzstd-devel, brew: zstd) and reinstall data.table from source."));
+#endif
+#ifdef NOLZ4
+  if (args.is_lz4)
+    STOP(_("compress='lz4' in fwrite uses the lz4 library. Its header files were not found at the time data.table was compiled. To enable it, please install liblz4 (e.g. deb: liblz4-dev, rpm: lz4-devel, brew: lz4) and reinstall data.table from source."));
+#endif
 
   // When NA is a non-empty string, then we must quote all string fields in case they contain the na string
   // na is recommended to be empty, though
@@ -632,6 +1105,7 @@ void fwriteMain(fwriteMainArgs args)
 
   qmethodEscape = args.qmethodEscape;
   squashDateTime = args.squashDateTime;
+  roundtrip = args.roundtrip;
 
   int eolLen=strlen(args.eol), naLen=strlen(args.na);
   // Aside: codacy wants strnlen but strnlen is not in C99 (neither is strlen_s). To pass `gcc -std=c99 -Wall -pedantic`
@@ -667,6 +1141,7 @@ void fwriteMain(fwriteMainArgs args)
 
   double t0 = wallclock();
   size_t maxLineLen = eolLen + args.ncol * (2*(doQuote!=0) + sepLen);
+  int nBatchCols = 0;
   if (args.doRowNames) {
     maxLineLen += args.rowNames==NULL ? 1 + (int)log10(args.nrow)   // the width of the row number
                   : (args.rowNameFun==WF_String ? getMaxStringLen(args.rowNames, args.nrow) * 2  // *2 in case longest row name is all quotes (!) and all get escaped
@@ -697,14 +1172,20 @@ void fwriteMain(fwriteMainArgs args)
     if (width < naLen)
       width = naLen;
     maxLineLen += width * 2;  // *2 in case the longest string is all quotes and they all need to be escaped
+    nBatchCols += args.batchFuns && args.batchFuns[args.whichFun[j]];
   }
+  if (nBatchCols)
+    maxLineLen += 8;  // room for the last 8 byte copy of a batch written cell to run past the end of the buffer's last line
   if (verbose)
     DTPRINT(_("maxLineLen=%"PRIu64". Found in %.3fs\n"), (uint64_t)maxLineLen, 1.0*(wallclock()-t0));
 
+  fwriteMemoryFree();
   int f = 0;
-  if (*args.filename=='\0') {
+  if (args.toMemory) {
+    f = MEM_OUT;
+  } else if (*args.filename=='\0') {
     f = -1;  // file="" means write to standard output
-    args.is_gzip = false; // gzip is only for file
+    args.is_gzip = args.is_zstd = args.is_lz4 = false; // compression is only for file
   } else {
 #ifdef WIN32
     f = _open(args.filename, _O_WRONLY | _O_BINARY | _O_CREAT | (args.append ? _O_APPEND : _O_TRUNC), _S_IWRITE);
@@ -765,8 +1246,8 @@ void fwriteMain(fwriteMainArgs args)
   }
 
   int rowsPerBatch = buffSize / maxLineLen;
-  // + 1 because of the last incomplete loop
-  int numBatches = args.nrow / rowsPerBatch + 1;
+  // rounded up for the last incomplete batch
+  int numBatches = (args.nrow + rowsPerBatch - 1) / rowsPerBatch;
 
   // force 1 batch, and then 1 thread, if number of lines in table < rowsPerBatch
   if (args.nrow < rowsPerBatch) {
@@ -777,31 +1258,35 @@ void fwriteMain(fwriteMainArgs args)
   // avoid useless threads, and then too big memory allocations
   if (numBatches < nth)
     nth = numBatches;
+  // two buffers per thread so that each formatting thread can fill its next batch while its last waits to be written
+  int nslot = numBatches < 2*nth ? numBatches : 2*nth;
 
   if (verbose) {
     DTPRINT(_("Writing %"PRId64" rows in %d batches of %d rows, each buffer size %zu bytes (%zu MiB), showProgress=%d, nth=%d\n"),
             args.nrow, numBatches, rowsPerBatch, buffSize, buffSize / MEGA, args.showProgress, nth);
   }
 
-  // alloc nth write buffers
+  // alloc nslot write buffers
   errno = 0;
-  size_t alloc_size = nth * buffSize;
+  size_t alloc_size = nslot * buffSize;
   if (verbose) {
     DTPRINT(_("Allocate %zu bytes (%zu MiB) for buffPool\n"), alloc_size, alloc_size / MEGA);
   }
   char *buffPool = malloc(alloc_size);
   if (!buffPool) {
     STOP(_("Unable to allocate %zu MB * %d thread buffers; '%d: %s'. Please read ?fwrite for nThread, buffMB and verbose options."), // # nocov
-         buffSize / MEGA, nth, errno, strerror(errno)); // # nocov
+         buffSize / MEGA, nslot, errno, strerror(errno)); // # nocov
   }
 
   // init compress variables
-#ifndef NOZLIB
-  z_stream strm;
   // NB: fine to free() this even if unallocated
   char *zbuffPool = NULL;
   size_t zbuffSize = 0;
   size_t compress_len = 0;
+  bool is_frame = args.is_zstd || args.is_lz4;
+  void **cctx = NULL;  // one zstd compression context per thread, reused across that thread's batches
+#ifndef NOZLIB
+  z_stream strm;
   if (args.is_gzip) {
     // compute zbuffSize which is the same for each thread
     if (init_stream(&strm) != Z_OK) {
@@ -816,7 +1301,7 @@ void fwriteMain(fwriteMainArgs args)
 
     // alloc nth zlib buffers
     // if headerLen > nth * zbuffSize (long variable names and 1 thread), alloc headerLen
-    alloc_size = nth * zbuffSize < headerLen ? headerLen : nth * zbuffSize;
+    alloc_size = nslot * zbuffSize < headerLen ? headerLen : nslot * zbuffSize;
     if (verbose) {
       DTPRINT(_("Allocate %zu bytes (%zu MiB) for zbuffPool\n"), alloc_size, alloc_size / MEGA);
     }
@@ -826,31 +1311,60 @@ void fwriteMain(fwriteMainArgs args)
       free(buffPool);
       deflateEnd(&strm);
       STOP(_("Unable to allocate %zu MiB * %d thread compressed buffers; '%d: %s'. Please read ?fwrite for nThread, buffMB and verbose options."),
-           zbuffSize / MEGA, nth, errno, strerror(errno));
+           zbuffSize / MEGA, nslot, errno, strerror(errno));
       // # nocov end
     }
     len = 0;
     crc = crc32(0L, Z_NULL, 0);
+  }
+#endif // #NOZLIB
+  if (is_frame) {
+    zbuffSize = frameBound(args.is_zstd, args.gzip_level, buffSize);
+    alloc_size = nslot * zbuffSize;
+    size_t headerBound = frameBound(args.is_zstd, args.gzip_level, headerLen);
+    if (alloc_size < headerBound) alloc_size = headerBound;
+    if (verbose)
+      DTPRINT(_("Allocate %zu bytes (%zu MiB) for zbuffPool; %s level %d frames of up to %zu bytes\n"),
+              alloc_size, alloc_size / MEGA, args.is_zstd ? "zstd" : "lz4", args.gzip_level, zbuffSize);
+    zbuffPool = malloc(alloc_size);
+    cctx = calloc(nth, sizeof(*cctx));
+    bool ok = zbuffPool && cctx;
+#ifndef NOZSTD
+    for (int i=0; ok && args.is_zstd && i<nth; i++)
+      ok = (cctx[i] = ZSTD_createCCtx()) != NULL;
+#endif
+    if (!ok) {
+      // # nocov start
+      if (f >= 0) CLOSE(f);
+      freeCCtx(cctx, nth);
+      free(zbuffPool);
+      free(buffPool);
+      STOP(_("Unable to allocate %zu MiB * %d thread compressed buffers; '%d: %s'. Please read ?fwrite for nThread, buffMB and verbose options."),
+           zbuffSize / MEGA, nslot, errno, strerror(errno));
+      // # nocov end
+    }
+    len = 0;
+  }
 
-    if (f != -1) {
-      // write minimal gzip header, but not on the console
-      static const char header[] = "\037\213\10\0\0\0\0\0\0\3";
-      int ret0 = WRITE(f, header, (sizeof header) - 1);
-      compress_len += (sizeof header) - 1;
+#ifndef NOZLIB
+  if (args.is_gzip && f != -1) {
+    // write minimal gzip header, but not on the console
+    static const char header[] = "\037\213\10\0\0\0\0\0\0\3";
+    int ret0 = writeOut(f, header, (sizeof header) - 1);
+    compress_len += (sizeof header) - 1;
 
-      if (ret0 == -1) {
-        // # nocov start
-        int errwrite = errno; // capture write errno now in case close fails with a different errno
-        CLOSE(f);
-        free(buffPool);
-        free(zbuffPool);
-        deflateEnd(&strm);
-        STOP(_("Failed to write gzip header. Write returned %d"), errwrite);
-        // # nocov end
-      }
+    if (ret0 == -1) {
+      // # nocov start
+      int errwrite = errno; // capture write errno now in case close fails with a different errno
+      CLOSE(f);
+      free(buffPool);
+      free(zbuffPool);
+      deflateEnd(&strm);
+      STOP(_("Failed to write gzip header. Write returned %d"), errwrite);
+      // # nocov end
     }
   }
-#endif // #NOZLIB
+#endif
 
   // write header
 
@@ -893,6 +1407,16 @@ void fwriteMain(fwriteMainArgs args)
       DTPRINT("%s", buff); // # notranslate
     } else {
       int ret1=0, ret2=0;
+      const char *frameErr = NULL;
+      if (is_frame) {
+        len = (size_t)(ch - buff);
+        size_t zbuffUsed = compressframe(args.is_zstd, cctx[0], args.gzip_level, zbuffPool, alloc_size, buff, len, &frameErr);
+        if (frameErr) ret1 = 1;
+        else {
+          ret2 = writeOut(f, zbuffPool, zbuffUsed);
+          compress_len += zbuffUsed;
+        }
+      } else
 #ifndef NOZLIB
       if (args.is_gzip) {
         char* zbuff = zbuffPool;
@@ -903,23 +1427,23 @@ void fwriteMain(fwriteMainArgs args)
         ret1 = compressbuff(&strm, zbuff, &zbuffUsed, buff, len);
         deflateEnd(&strm);
         if (ret1==Z_OK) {
-          ret2 = WRITE(f, zbuff, (int)zbuffUsed);
+          ret2 = writeOut(f, zbuff, zbuffUsed);
           compress_len += zbuffUsed;
         }
       } else {
 #endif
-        ret2 = WRITE(f,  buff, (int)(ch-buff));
+        ret2 = writeOut(f, buff, (size_t)(ch-buff));
 #ifndef NOZLIB
       }
 #endif
       if (ret1 || ret2 == -1) {
         // # nocov start
         int errwrite = errno; // capture write errno now in case close fails with a different errno
-        CLOSE(f);
+        if (f >= 0) CLOSE(f);
         free(buffPool);
-#ifndef NOZLIB
         free(zbuffPool);
-#endif
+        freeCCtx(cctx, nth);
+        if (frameErr) STOP(_("Failed to compress %s frame: %s"), args.is_zstd ? "zstd" : "lz4", frameErr);
         if (ret1) STOP(_("Failed to compress gzip. compressbuff() returned %d"), ret1);
         else STOP(_("%s: '%s'"), strerror(errwrite), args.filename);
         // # nocov end
@@ -940,10 +1464,9 @@ void fwriteMain(fwriteMainArgs args)
     if (verbose)
       DTPRINT(_("No data rows present (nrow==0)\n"));
     free(buffPool);
-#ifndef NOZLIB
     free(zbuffPool);
-#endif
-    if (f != -1 && CLOSE(f))
+    freeCCtx(cctx, nth);
+    if (f >= 0 && CLOSE(f))
       STOP(_("%s: '%s'"), strerror(errno), args.filename); // # nocov
     return;
   }
@@ -952,152 +1475,230 @@ void fwriteMain(fwriteMainArgs args)
 
   t0 = wallclock();
 
+  // Columns that have a batch writer are formatted a column slice at a time into each thread's scratch buffer,
+  // then copied into the line buffer cell by cell as sep and eol are added. Their cells sum to no more than
+  // maxLineLen per row so a scratch buffer of buffSize is enough; widths holds rowsPerBatch cells per column.
+  bool *batchCol = calloc(args.ncol, sizeof(*batchCol));
+  if (!batchCol) {
+    // # nocov start
+    if (f >= 0) CLOSE(f);
+    free(buffPool);
+    free(zbuffPool);
+    freeCCtx(cctx, nth);
+    STOP(_("Unable to allocate %d bytes for batchCol"), args.ncol);
+    // # nocov end
+  }
+  for (int j=0; j<args.ncol; j++)
+    batchCol[j] = args.batchFuns && args.batchFuns[args.whichFun[j]];
+  char *scratchPool = NULL, **posPool = NULL;
+  int32_t *widthsPool = NULL;
+  if (nBatchCols) {
+    scratchPool = malloc(nth * buffSize);
+    posPool = malloc((size_t)nth * args.ncol * sizeof(*posPool));
+    widthsPool = malloc((size_t)nth * rowsPerBatch * args.ncol * sizeof(*widthsPool));
+    if (!scratchPool || !posPool || !widthsPool) {
+      // # nocov start
+      if (f >= 0) CLOSE(f);
+      free(scratchPool); free(posPool); free(widthsPool); free(batchCol); free(buffPool);
+      free(zbuffPool);
+      freeCCtx(cctx, nth);
+      STOP(_("Unable to allocate %zu MiB * %d thread scratch buffers for column at a time formatting; '%d: %s'. Please read ?fwrite for nThread, buffMB and verbose options."),
+           buffSize / MEGA, nth, errno, strerror(errno));
+      // # nocov end
+    }
+  }
+  if (verbose)
+    DTPRINT(_("Formatting %d of %d columns a column at a time\n"), nBatchCols, args.ncol);
+  if (verbose) {
+    if (nth > 1)
+      DTPRINT(_("%d threads fill %d buffers which one of them writes in order, formatting too while the next isn't ready\n"), nth, nslot);
+    else
+      DTPRINT(_("1 thread formats each batch and then writes it\n"));
+  }
+
   bool hasPrinted = false;
   int maxBuffUsedPC = 0;
 
-  bool failed = false;   // naked (unprotected by atomic) write to bool ok because only ever write true in this special paradigm
-  int failed_compress = 0; // the first thread to fail writes their reason here when they first get to ordered section
-  int failed_write = 0;    // same. could use +ve and -ve in the same code but separate it out to trace Solaris problem, #3931
-
-// main parallel loop ----
-#pragma omp parallel for ordered num_threads(nth) schedule(dynamic)
-  for(int64_t start=0; start < args.nrow; start += rowsPerBatch) {
-    int me = omp_get_thread_num();
-    int my_failed_compress = 0;
-    char* myBuff = buffPool + me * buffSize;
-    char* ch = myBuff;
-
+  bool failed = false;   // only the writer thread sets this; the formatting threads read it to stop early
 #ifndef NOZLIB
-    z_stream mystream;
-    size_t mylen = 0;
-    int mycrc = 0;
-    void *myzBuff = NULL;
-    size_t myzbuffUsed = 0;
-    if (args.is_gzip) {
-      myzBuff = zbuffPool + me * zbuffSize;
-      if (init_stream(&mystream) != Z_OK) { // this should be thread safe according to zlib documentation
-        failed = true;              // # nocov
-        my_failed_compress = -998;  // # nocov
-      }
-    }
+  int failed_compress = 0; // the writer copies the reason of the first failed batch here
 #endif
-    if (failed)
-      continue;  // Not break. Because we don't use #omp cancel yet.
-    int64_t end = ((args.nrow - start) < rowsPerBatch) ? args.nrow : start + rowsPerBatch;
+  int failed_write = 0;    // same. could use +ve and -ve in the same code but separate it out to trace Solaris problem, #3931
+  const char *failed_frame = NULL;  // same, for zstd and lz4 whose libraries give their reason as a string
 
-    // chunk rows
-    for (int64_t i = start; i < end; i++) {
-      // Tepid starts here (once at beginning of each line)
-      if (args.doRowNames) {
-        if (args.rowNames==NULL) {
-          if (doQuote==1)
-            *ch++='"';
-          int64_t rn = i+1;
-          writeInt64(&rn, 0, &ch);
-          if (doQuote==1)
-            *ch++='"';
-        } else {
-          if (args.rowNameFun != WF_String && doQuote==1)
-            *ch++='"';
-          (args.funs[args.rowNameFun])(args.rowNames, i, &ch);  // #5098
-          if (args.rowNameFun != WF_String && doQuote==1)
-            *ch++='"';
+  writeSlot *slots = malloc(nslot * sizeof(*slots));
+  if (!slots) {
+    // # nocov start
+    if (f >= 0) CLOSE(f);
+    free(scratchPool); free(posPool); free(widthsPool); free(batchCol); free(buffPool); free(zbuffPool);
+    freeCCtx(cctx, nth);
+    STOP(_("Unable to allocate %d write slots"), nslot);
+    // # nocov end
+  }
+  for (int k=0; k<nslot; k++) {
+    slots[k].batch = -1;
+    slots[k].buff = buffPool + k * buffSize;
+    slots[k].zbuff = zbuffPool ? zbuffPool + k * zbuffSize : NULL;
+  }
+  batchWriter bw = { .args=&args, .rowsPerBatch=rowsPerBatch, .buffSize=buffSize, .zbuffSize=zbuffSize,
+                     .batchCol=batchCol, .nBatchCols=nBatchCols, .scratchPool=scratchPool, .posPool=posPool, .widthsPool=widthsPool,
+                     .is_frame=is_frame, .cctx=cctx };
+  int64_t nextBatch = 0;  // the next batch for a formatting thread to take
+  int64_t nWritten = 0;   // batches written so far; a batch's slot is free once the batch nslot before it is written
+  double tFormat=0, tCompress=0, tFull=0, tWrite=0, tEmpty=0;
+
+// main parallel region ----
+// Thread 0 writes the batches in order while the other nth-1 threads format (and compress) them into a ring of nslot
+// buffers, so a thread can format a batch up to nslot batches ahead of the one being written rather than wait its
+// turn to write its own. While the next batch to write isn't ready, thread 0 formats batches too, so all nth threads
+// format unless the output is slower than them. Thread 0 is the master so it may print to the console and the progress meter.
+#pragma omp parallel num_threads(nth)
+  {
+    const int me = omp_get_thread_num();
+    // alone without OpenMP, or if the runtime gave us only one thread: format each batch and then write it
+    const bool alone = omp_get_num_threads()==1;
+    double myFormat=0, myCompress=0, myFull=0;
+    if (me!=0) {
+      const int fi = me-1;
+      for (;;) {
+        int64_t b;
+        #pragma omp atomic capture
+        b = nextBatch++;
+        if (b >= numBatches)
+          break;
+        // wait for the writer to free this batch's slot; i.e. to write batch b-nslot
+        double t0 = wallclock();
+        for (int spins=0; ; ) {
+          int64_t written;
+          bool stop;
+          #pragma omp atomic read
+          written = nWritten;
+          #pragma omp atomic read
+          stop = failed;
+          if (written > b-nslot || stop) break;
+          backoff(&spins);
         }
-        *ch = sep;
-        ch += sepLen;
-      }
-      // Hot loop
-      for (int j=0; j<args.ncol; j++) {
-        (args.funs[args.whichFun[j]])(args.columns[j], i, &ch);
-        *ch = sep;
-        ch += sepLen;
-      }
-      // Tepid again (once at the end of each line)
-      ch -= sepLen;  // backup onto the last sep after the last column. ncol>=1 because 0-columns was caught earlier.
-      write_chars(args.eol, &ch);  // overwrite last sep with eol instead
-    } // end of chunk rows loop
-
-    // compress buffer if gzip
-#ifndef NOZLIB
-    if (args.is_gzip && !failed) {
-      myzbuffUsed = zbuffSize;
-      mylen = (size_t)(ch - myBuff);
-      mycrc = crc32(0, (unsigned char*)myBuff, mylen);
-      int ret = compressbuff(&mystream, myzBuff, &myzbuffUsed, myBuff, mylen);
-      deflateEnd(&mystream);
-      if (ret) {
-        failed=true;
-        my_failed_compress=ret;
-      }
-    }
-#endif
-
-      // ordered region ----
-#pragma omp ordered
-    if (failed) {
-      if (failed_compress==0 && my_failed_compress!=0) {
-        failed_compress = my_failed_compress; // # nocov
+        myFull += wallclock()-t0;
+        bool stop;
+        #pragma omp atomic read
+        stop = failed;
+        if (stop) break;  // the writer has finished and won't read this slot
+        fillSlot(&bw, slots + b%nslot, b, fi, &myFormat, &myCompress);
       }
-      // else another thread could have failed below while I was working or waiting above; their reason got here first
     } else {
-      errno=0;
-      int ret = 0;
-      if (f == -1) {
-        *ch='\0';  // standard C string end marker so DTPRINT knows where to stop
-        DTPRINT("%s", myBuff); // # notranslate
-      } else
+      int64_t own = -1;  // a batch the writer has taken to format itself, which it does as soon as the batch's slot is free
+      for (int64_t b=0; b<numBatches; b++) {
+        writeSlot *slot = slots + b%nslot;
+        if (alone) fillSlot(&bw, slot, b, 0, &myFormat, &myCompress);
+        double t0 = wallclock(), tOwn = 0;
+        for (int spins=0; ; ) {
+          int64_t ready;
+          #pragma omp atomic read
+          ready = slot->batch;
+          if (ready == b) break;
+          // Rather than wait for batch b, format the next batch with the formatting threads. Batches before b+nslot
+          // have free slots since batches up to b-1 are written. The batch is taken before its slot is known to be
+          // free, since it can't be taken only if so, and then kept until it is.
+          if (own == -1) {
+            int64_t next;
+            #pragma omp atomic read
+            next = nextBatch;
+            if (next < b+nslot && next < numBatches) {
+              #pragma omp atomic capture
+              own = nextBatch++;
+              if (own >= numBatches) own = -2;  // all taken: no more to format
+            }
+          }
+          if (own >= 0 && own < b+nslot) {
+            double t2 = wallclock();
+            fillSlot(&bw, slots + own%nslot, own, nth-1, &myFormat, &myCompress);
+            tOwn += wallclock()-t2;
+            own = -1;
+            spins = 0;
+            continue;
+          }
+          backoff(&spins);
+        }
+        #pragma omp flush
+        double t1 = wallclock();
+        tEmpty += t1-t0-tOwn;
+        if (slot->failed_compress || slot->failed_frame) {
 #ifndef NOZLIB
-        if (args.is_gzip) {
-          ret = WRITE(f, myzBuff, (int)myzbuffUsed);
-          compress_len += myzbuffUsed;
-        } else
+          failed_compress = slot->failed_compress; // # nocov
 #endif
-      {
-        ret = WRITE(f, myBuff,  (int)(ch-myBuff));
-      }
-      if (ret == -1) {
-        failed=true;         // # nocov
-        failed_write=errno;  // # nocov
-      }
-
+          failed_frame = slot->failed_frame;       // # nocov
+          #pragma omp atomic write
+          failed = true;                           // # nocov
+          break;                                   // # nocov
+        }
+        errno=0;
+        int ret = 0;
+        if (f == -1) {
+          slot->buff[slot->buffUsed] = '\0';  // standard C string end marker so DTPRINT knows where to stop
+          DTPRINT("%s", slot->buff); // # notranslate
+        } else if (args.is_gzip || is_frame) {
+          ret = writeOut(f, slot->zbuff, slot->zbuffUsed);
+          compress_len += slot->zbuffUsed;
+        } else {
+          ret = writeOut(f, slot->buff, slot->buffUsed);
+        }
+        if (ret == -1) {
+          failed_write=errno;  // # nocov
+          #pragma omp atomic write
+          failed = true;       // # nocov
+          break;               // # nocov
+        }
 #ifndef NOZLIB
-      if (args.is_gzip) {
-          crc = crc32_combine(crc, mycrc, mylen);
-          len += mylen;
-      }
+        if (args.is_gzip)
+          crc = crc32_combine(crc, slot->mycrc, slot->mylen);
 #endif
-
-      int used = 100 * ((double)(ch - myBuff)) / buffSize;  // percentage of original buffMB
-      if (used > maxBuffUsedPC)
-        maxBuffUsedPC = used;
-      double now;
-      if (me == 0 && !failed && args.showProgress && (now=wallclock()) >= nextTime) {
-        // See comments above inside the f==-1 clause.
-        // Not only is this ordered section one-at-a-time but we'll also Rprintf() here only from the
-        // master thread (me==0) and hopefully this will work on Windows. If not, user should set
-        // showProgress=FALSE until this can be fixed or removed.
-        int ETA = (int)((args.nrow - end) * (now-startTime) /end);
-        if (hasPrinted || ETA >= 2) {
-          // # nocov start
-          if (verbose && !hasPrinted) DTPRINT("\n"); // # notranslate
-          DTPRINT(Pl_(nth,
-                  "\rWritten %.1f%% of %"PRId64" rows in %d secs using %d thread. maxBuffUsed=%d%%. ETA %d secs.      ",
-                  "\rWritten %.1f%% of %"PRId64" rows in %d secs using %d threads. maxBuffUsed=%d%%. ETA %d secs.      "),
-                  (100.0*end)/args.nrow, args.nrow, (int)(now-startTime), nth, maxBuffUsedPC, ETA); // # nocov
-          // TODO: use progress() as in fread
-          nextTime = now + 1;
-          hasPrinted = true;
-          // # nocov end
+        len += slot->mylen;  // 0 unless compressing
+        int used = 100 * ((double)slot->buffUsed) / buffSize;  // percentage of original buffMB
+        if (used > maxBuffUsedPC)
+          maxBuffUsedPC = used;
+        double now = wallclock();
+        tWrite += now-t1;
+        #pragma omp atomic write
+        nWritten = b+1;  // the slot is a formatting thread's from here on
+
+        int64_t end = (b+1)*rowsPerBatch < args.nrow ? (b+1)*rowsPerBatch : args.nrow;
+        if (args.showProgress && now >= nextTime) {
+          // Only the master thread (me==0) prints, and hopefully this will work on Windows. If not, user should set
+          // showProgress=FALSE until this can be fixed or removed.
+          int ETA = (int)((args.nrow - end) * (now-startTime) /end);
+          if (hasPrinted || ETA >= 2) {
+            // # nocov start
+            if (verbose && !hasPrinted) DTPRINT("\n"); // # notranslate
+            DTPRINT(Pl_(nth,
+                    "\rWritten %.1f%% of %"PRId64" rows in %d secs using %d thread. maxBuffUsed=%d%%. ETA %d secs.      ",
+                    "\rWritten %.1f%% of %"PRId64" rows in %d secs using %d threads. maxBuffUsed=%d%%. ETA %d secs.      "),
+                    (100.0*end)/args.nrow, args.nrow, (int)(now-startTime), nth, maxBuffUsedPC, ETA); // # nocov
+            // TODO: use progress() as in fread
+            nextTime = now + 1;
+            hasPrinted = true;
+            // # nocov end
+          }
         }
       }
     }
-
-  } // end of parallel for loop
+    #pragma omp atomic update
+    tFormat += myFormat;
+    #pragma omp atomic update
+    tCompress += myCompress;
+    #pragma omp atomic update
+    tFull += myFull;
+  } // end of parallel region
+  free(slots);
 
   free(buffPool);
+  free(scratchPool);
+  free(posPool);
+  free(widthsPool);
+  free(batchCol);
+  free(zbuffPool);
+  freeCCtx(cctx, nth);
 
 #ifndef NOZLIB
-  free(zbuffPool);
 
 /* put a 4-byte integer into a byte array in LSB order */
 #define PUT4(a,b) ((a)[0]=(b), (a)[1]=(b)>>8, (a)[2]=(b)>>16, (a)[3]=(b)>>24)
@@ -1109,7 +1710,7 @@ void fwriteMain(fwriteMainArgs args)
     tail[1] = 0;
     PUT4(tail + 2, crc);
     PUT4(tail + 6, len);
-    int ret = WRITE(f, tail, 10);
+    int ret = writeOut(f, tail, 10);
     compress_len += 10;
     if (ret == -1)
       STOP(_("Failed to write gzip trailer")); // # nocov
@@ -1135,14 +1736,27 @@ void fwriteMain(fwriteMainArgs args)
               len, len / MEGA, compress_len, compress_len / MEGA, len != 0 ? (100.0 * compress_len) / len : 0, crc);
     }
 #endif
+    if (is_frame) {
+      DTPRINT(_("%s: uncompressed length=%zu (%zu MiB), compressed length=%zu (%zu MiB), ratio=%.1f%%, frames=%"PRId64"\n"),
+              args.is_zstd ? "zstd" : "lz4", len, len / MEGA, compress_len, compress_len / MEGA,
+              len != 0 ? (100.0 * compress_len) / len : 0, (args.nrow + rowsPerBatch - 1) / rowsPerBatch + (headerLen != 0));
+    }
     DTPRINT(Pl_(nth, Pl_(args.nrow, "Wrote %"PRId64" row in %.3f secs using %d thread. MaxBuffUsed=%d%%\n",
                                     "Wrote %"PRId64" rows in %.3f secs using %d thread. MaxBuffUsed=%d%%\n"),
                      Pl_(args.nrow, "Wrote %"PRId64" row in %.3f secs using %d threads. MaxBuffUsed=%d%%\n",
                                     "Wrote %"PRId64" rows in %.3f secs using %d threads. MaxBuffUsed=%d%%\n")),
             args.nrow, 1.0*(wallclock()-t0), nth, maxBuffUsedPC);
+    DTPRINT(_("Formatting %.3fs, compressing %.3fs and waiting for a free buffer %.3fs, summed over the threads; writing %.3fs and waiting for the next batch %.3fs in the writer thread\n"),
+            tFormat, tCompress, tFull, tWrite, tEmpty);
   }
 
-  if (f != -1 && CLOSE(f) && !failed)
+  if (f == MEM_OUT && memCap > memUsed && !failed) {
+    // give back the spare capacity of the last doubling before fwriteR.c copies the output into a raw vector, so that
+    // the two are about twice its size at the peak rather than up to three times
+    char *tt = realloc(memBuff, memUsed ? memUsed : 1);
+    if (tt) { memBuff = tt; memCap = memUsed; }
+  }
+  if (f >= 0 && CLOSE(f) && !failed)
     STOP("%s: '%s'", strerror(errno), args.filename);  // # nocov, # notranslate
   // quoted '%s' in case of trailing spaces in the filename
   // If a write failed, the line above tries close() to clean up, but that might fail as well. So the
@@ -1157,6 +1771,8 @@ void fwriteMain(fwriteMainArgs args)
            verbose ? _("Please include the full output above and below this message in your data.table bug report.")
                    : _("Please retry fwrite() with verbose=TRUE and include the full output with your data.table bug report."));
 #endif
+    if (failed_frame)
+      STOP(_("Failed to compress %s frame: %s"), args.is_zstd ? "zstd" : "lz4", failed_frame);
     if (failed_write)
       STOP("%s: '%s'", strerror(failed_write), args.filename); // # notranslate
     // # nocov end
@@ -34,6 +34,23 @@ writer_fun_t writeList;
 
 void write_chars(const char *source, char **dest);
 
+// Batch writers format rows [from,to) of one column contiguously at *dest and store the width of each cell in widths[].
+// fwriteMain() calls them column by column into a scratch buffer and then interleaves the cells with sep and eol, so
+// the per-cell indirect call and the reload of per-column state are paid once per column slice rather than once per cell.
+typedef void writer_batch_fun_t(const void *, int64_t, int64_t, char **, int32_t *);
+
+// in the same order as writer_fun_t above; NULL in fwriteR.c's batchFuns[] for writers that have no batch version
+writer_batch_fun_t writeBool8Batch;
+writer_batch_fun_t writeBool32Batch;
+writer_batch_fun_t writeBool32AsStringBatch;
+writer_batch_fun_t writeInt32Batch;
+writer_batch_fun_t writeInt64Batch;
+writer_batch_fun_t writeFloat64Batch;
+writer_batch_fun_t writeITimeBatch;
+writer_batch_fun_t writeDateInt32Batch;
+writer_batch_fun_t writeDateFloat64Batch;
+writer_batch_fun_t writePOSIXctBatch;
+
 typedef enum {   // same order as fun[] above
   WF_Bool8,
   WF_Bool32,
@@ -81,6 +98,7 @@ typedef struct fwriteMainArgs
   // a vector of pointers to all-same-length column vectors
   const void **columns;
   writer_fun_t **funs;    // a vector of writer_fun_t function pointers
+  writer_batch_fun_t **batchFuns;  // optional; same length and order as funs, NULL entries (or NULL itself) mean per-cell only
 
   // length ncol vector containing which fun[] to use for each column
   // one byte to use 8 times less cache lines than a vector of function pointers would do
@@ -108,15 +126,21 @@ typedef struct fwriteMainArgs
                           //   10000000 to 1e+07, first has width 8, second has width 5; prefer the former
                           //   iff scipen >= 3=8-5
   bool squashDateTime;
+  bool roundtrip;         // write doubles with the shortest digits that read back identically (up to 17 s.f.) rather than at most 15 s.f.
   bool append;
   int buffMB;             // [1-1024] default 8MB
   int nth;
   bool showProgress;
   bool is_gzip;
-  int gzip_level;
+  bool is_zstd;           // each batch is compressed as an independent zstd (or lz4) frame; see compressframe()
+  bool is_lz4;
+  int gzip_level;         // the compression level of whichever of gzip, zstd or lz4 is set
   bool bom;
   const char *yaml;
   bool verbose;
+  bool toMemory;          // write to memory rather than to filename, for fwriteMemory() to return
 } fwriteMainArgs;
 
 void fwriteMain(fwriteMainArgs args);
+const char *fwriteMemory(size_t *len);  // the output of the last fwriteMain() with toMemory, until the next call or:
+void fwriteMemoryFree(void);
@@ -71,6 +71,24 @@ writer_fun_t *funs[] = {
   &writeList
 };
 
+writer_batch_fun_t *batchFuns[] = {  // same order as funs[] above; NULL means the column is written cell by cell
+  &writeBool8Batch,
+  &writeBool32Batch,
+  &writeBool32AsStringBatch,
+  &writeInt32Batch,
+  &writeInt64Batch,
+  &writeFloat64Batch,
+  NULL,  // writeComplex
+  &writeITimeBatch,
+  &writeDateInt32Batch,
+  &writeDateFloat64Batch,
+  &writePOSIXctBatch,
+  NULL,  // writeNanotime
+  NULL,  // writeString
+  NULL,  // writeCategString
+  NULL   // writeList
+};
+
 static int32_t whichWriter(SEXP);
 
 void writeList(const void *col, int64_t row, char **pch) {
@@ -149,7 +167,7 @@ static int32_t whichWriter(SEXP column) {
 
 SEXP fwriteR(
   SEXP DF,                 // any list of same length vectors; e.g. data.frame, data.table
-  SEXP filename_Arg,
+  SEXP filename_Arg,       // or raw() to write to a raw vector which is returned
   SEXP sep_Arg,
   SEXP sep2_Arg,
   SEXP eol_Arg,
@@ -162,11 +180,12 @@ SEXP fwriteR(
   SEXP colNames_Arg,       // TRUE|FALSE
   SEXP logical01_Arg,      // TRUE|FALSE
   SEXP scipen_Arg,
+  SEXP roundtrip_Arg,      // TRUE|FALSE
   SEXP dateTimeAs_Arg,     // 0=ISO(yyyy-mm-dd),1=squash(yyyymmdd),2=epoch,3=write.csv
   SEXP buffMB_Arg,         // [1-1024] default 8MB
   SEXP nThread_Arg,
   SEXP showProgress_Arg,
-  SEXP is_gzip_Arg,
+  SEXP compress_Arg,       // "none"|"gzip"|"zstd"|"lz4"; "auto" is resolved at R level
   SEXP gzip_level_Arg,
   SEXP bom_Arg,
   SEXP yaml_Arg,
@@ -177,12 +196,16 @@ SEXP fwriteR(
   if (!isNewList(DF)) error(_("fwrite must be passed an object of type list; e.g. data.frame, data.table"));
 
   fwriteMainArgs args = {0};  // {0} to quieten valgrind's uninitialized, #4639
-  args.is_gzip = LOGICAL(is_gzip_Arg)[0];
+  const char *compress = CHAR(STRING_ELT(compress_Arg, 0));
+  args.is_gzip = !strcmp(compress, "gzip");
+  args.is_zstd = !strcmp(compress, "zstd");
+  args.is_lz4 = !strcmp(compress, "lz4");
   args.gzip_level = INTEGER(gzip_level_Arg)[0];
   args.bom = LOGICAL(bom_Arg)[0];
   args.yaml = CHAR(STRING_ELT(yaml_Arg, 0));
   args.verbose = LOGICAL(verbose_Arg)[0];
-  args.filename = CHAR(STRING_ELT(filename_Arg, 0));
+  args.toMemory = TYPEOF(filename_Arg) == RAWSXP;
+  args.filename = args.toMemory ? "" : CHAR(STRING_ELT(filename_Arg, 0));
   args.ncol = length(DF);
   if (args.ncol==0) {
     warning(_("fwrite was passed an empty list of no columns. Nothing to write."));
@@ -223,6 +246,7 @@ SEXP fwriteR(
   args.columns = (void *)R_alloc(args.ncol, sizeof(*args.columns));
 
   args.funs = funs;  // funs declared statically at the top of this file
+  args.batchFuns = batchFuns;
 
   // Allocate and populate lookup vector to writer function for each column, whichFun[]
   args.whichFun = (uint8_t *)R_alloc(args.ncol, sizeof(*args.whichFun));
@@ -232,6 +256,7 @@ SEXP fwriteR(
   dateTimeAs = INTEGER(dateTimeAs_Arg)[0];
   logical01 = LOGICAL(logical01_Arg)[0];
   args.scipen = INTEGER(scipen_Arg)[0];
+  args.roundtrip = LOGICAL(roundtrip_Arg)[0];
   utf8 = !strcmp(CHAR(STRING_ELT(encoding_Arg, 0)), "UTF-8");
   native = !strcmp(CHAR(STRING_ELT(encoding_Arg, 0)), "native");
 
@@ -309,6 +334,14 @@ SEXP fwriteR(
 
   fwriteMain(args);
 
+  SEXP ans = R_NilValue;
+  if (args.toMemory) {
+    size_t len;
+    const char *mem = fwriteMemory(&len);
+    ans = PROTECT(allocVector(RAWSXP, len)); protecti++;
+    if (len) memcpy(RAW(ans), mem, len);
+    fwriteMemoryFree();
+  }
   UNPROTECT(protecti);
-  return(R_NilValue);
+  return ans;
 }
\ No newline at end of file
@@ -40,6 +40,10 @@ SEXP sym_inherits;
 SEXP sym_datatable_locked;
 SEXP sym_tzone;
 SEXP sym_old_fread_datetime_character;
+SEXP sym_fread_cache;
+SEXP sym_fread_input;
+SEXP sym_fread_cmd_max;
+SEXP sym_fileNrows;
 SEXP sym_variable_table;
 SEXP sym_as_character;
 SEXP sym_as_posixct;
@@ -67,6 +71,7 @@ R_CallMethodDef callMethods[] = {
 {"Cchmatchdup", (DL_FUNC) &chmatchdup_R, -1},
 {"Cchin", (DL_FUNC) &chin_R, -1},
 {"CfreadR", (DL_FUNC) &freadR, -1},
+{"CgzipSizesR", (DL_FUNC) &gzipSizesR, -1},
 {"CfwriteR", (DL_FUNC) &fwriteR, -1},
 {"Creorder", (DL_FUNC) &reorder, -1},
 {"Crbindlist", (DL_FUNC) &rbindlist, -1},
@@ -145,6 +150,8 @@ R_CallMethodDef callMethods[] = {
 {"Ctest_dt_win_snprintf", (DL_FUNC)&test_dt_win_snprintf, -1},
 {"Cdt_zlib_version", (DL_FUNC)&dt_zlib_version, -1},
 {"Cdt_has_zlib", (DL_FUNC)&dt_has_zlib, -1},
+{"Cdt_has_zstd", (DL_FUNC)&dt_has_zstd, -1},
+{"Cdt_has_lz4", (DL_FUNC)&dt_has_lz4, -1},
 {"Csubstitute_call_arg_namesR", (DL_FUNC) &substitute_call_arg_namesR, -1},
 {"CstartsWithAny", (DL_FUNC)&startsWithAny, -1},
 {"CconvertDate", (DL_FUNC)&convertDate, -1},
@@ -296,6 +303,10 @@ void attribute_visible R_init_data_table(DllInfo *info)
   sym_datatable_locked = install(".data.table.locked");
   sym_tzone = install("tzone");
   sym_old_fread_datetime_character = install("datatable.old.fread.datetime.character");
+  sym_fread_cache = install("datatable.fread.cache");
+  sym_fread_input = install("datatable.fread.input");
+  sym_fread_cmd_max = install("datatable.fread.cmd.max");
+  sym_fileNrows = install("fileNrows");
   sym_variable_table = install("variable_table");
   sym_as_character = install("as.character");
   sym_as_posixct = install("as.POSIXct");
@@ -427,6 +427,20 @@ SEXP dt_has_zlib(void) {
   return ScalarLogical(0);
 #endif
 }
+SEXP dt_has_zstd(void) {
+#ifndef NOZSTD
+  return ScalarLogical(1);
+#else
+  return ScalarLogical(0);
+#endif
+}
+SEXP dt_has_lz4(void) {
+#ifndef NOLZ4
+  return ScalarLogical(1);
+#else
+  return ScalarLogical(0);
+#endif
+}
 
 SEXP startsWithAny(const SEXP x, const SEXP y, SEXP start) {
   // for is_url in fread.R added in #5097